@@ -0,0 +1,376 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "rc.hpp"
+#include "stats.hpp"
+#include "perf.hpp"
+#include "validate.hpp"
+
+// rc_bench: parameter-sweep benchmark for the Radiance Cascade pipeline.
+// For every (resolution, cascades, probe size, interval length) combination it runs warm-up
+// iterations, then N timed iterations of run_full_rc + radial stats dispatch, and reports
+// min / median / p95 of the raw (unsmoothed) Perf samples per stage as JSON or CSV.
+// Each timed iteration ends with glFinish so GPU queries resolve for that iteration.
+// Reduced storage formats also report their radial-profile error against RGBA32F, and their
+// full-image error (GPU-reduced) against an RGBA32F reference-schedule run.
+
+namespace {
+
+struct Resolution { int w, h; };
+
+struct Options {
+  std::vector<Resolution> resolutions = {{512, 512}, {1024, 1024}, {2048, 2048}, {3840, 2160}, {7680, 4320}};
+  std::vector<int>   cascades   = {4, 6, 8};
+  std::vector<int>   probeSizes = {1, 2};
+  std::vector<float> intervals  = {0.2f, 0.5f};
+  std::vector<RCStorageFormat> formats = {RCStorageFormat::RGBA32F};
+  std::vector<RCStepSchedule>  schedules = {RCStepSchedule{}};
+  int  warmup     = 3;
+  int  iterations = 10;
+  bool csv        = false;
+  bool preaverage = false;
+  int  sharedTiles = 0;  // max cascades marched from shared-memory scene tiles
+  RCSpaceSkipping skipping = RCSpaceSkipping::None;
+  int  primitives = 0;  // 0 -> built-in circle
+  int  referenceCascades = 0;  // > 0: image error of every configuration against this many cascades
+  std::string output;  // empty -> stdout
+  RCTemporalSettings temporal;
+};
+
+struct Summary { double min = 0.0, median = 0.0, p95 = 0.0; };
+
+// Nearest-rank percentiles over the collected samples.
+Summary summarize(std::vector<double> v) {
+  Summary s;
+  if (v.empty()) return s;
+  std::sort(v.begin(), v.end());
+  auto rank = [&](double p) {
+    size_t idx = size_t(std::max(0.0, std::ceil(p * double(v.size())) - 1.0));
+    return v[std::min(idx, v.size() - 1)];
+  };
+  s.min    = v.front();
+  s.median = rank(0.5);
+  s.p95    = rank(0.95);
+  return s;
+}
+
+// Metric columns, in output order
+enum Metric {
+  kCpuScene, kCpuCascades, kCpuBlit, kCpuRC, kCpuStats,
+  kGpuScene, kGpuClear, kGpuCascades, kGpuBlit, kGpuRC, kGpuStats, kWall,
+  kMetricCount
+};
+static const char* kMetricNames[kMetricCount] = {
+  "cpu_scene_ms", "cpu_cascades_ms", "cpu_blit_ms", "cpu_rc_ms", "cpu_stats_ms",
+  "gpu_scene_ms", "gpu_clear_ms", "gpu_cascades_ms", "gpu_blit_ms", "gpu_rc_ms", "gpu_stats_ms", "wall_ms",
+};
+
+struct Result {
+  Resolution res;
+  int   cascades;
+  int   probeSize;
+  float interval;
+  RCStorageFormat format;
+  RCStepSchedule  schedule;
+  RadialStatsError error;  // vs RGBA32F with the reference schedule; zero for that itself
+  ImageErrorMetrics image;  // full image vs the reference run (see --reference-cascades)
+  Summary metrics[kMetricCount];
+  std::vector<Summary> cascade;  // GPU time per cascade index
+  std::vector<double>  stepsPerTexel;  // march iterations per texel per cascade (one counted run)
+};
+
+template <typename T, typename Parse>
+bool parseList(const char* s, std::vector<T>& out, Parse parse) {
+  out.clear();
+  std::string str(s);
+  size_t pos = 0;
+  while (pos <= str.size()) {
+    size_t comma = str.find(',', pos);
+    std::string tok = str.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+    T v{};
+    if (tok.empty() || !parse(tok, v)) return false;
+    out.push_back(v);
+    if (comma == std::string::npos) break;
+    pos = comma + 1;
+  }
+  return !out.empty();
+}
+
+bool parseResolution(const std::string& tok, Resolution& r) {
+  int w = 0, h = 0;
+  if (std::sscanf(tok.c_str(), "%dx%d", &w, &h) == 2) { r = {w, h}; }
+  else if (std::sscanf(tok.c_str(), "%d", &w) == 1)  { r = {w, w}; }
+  else return false;
+  return r.w > 0 && r.h > 0;
+}
+
+void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --resolutions LIST   comma separated N or WxH (default 512,1024,2048,3840x2160,7680x4320)\n"
+    "  --cascades LIST      NUM_CASCADES values (default 4,6,8)\n"
+    "  --probe-sizes LIST   baseProbeSize values (default 1,2)\n"
+    "  --intervals LIST     baseIntervalLength values (default 0.2,0.5)\n"
+    "  --formats LIST       cascade storage formats (default rgba32f; also rgba16f, r11g11b10f_r8,\n"
+    "                       r11g11b10f_r16, rgb9e5_r16)\n"
+    "  --schedules LIST     interval traversal schedules (default reference; also per-pixel[:N], dda)\n"
+    "  --warmup N           untimed iterations per configuration (default 3)\n"
+    "  --iterations N       timed iterations per configuration (default 10)\n"
+    "  --temporal K         staggered cascade refresh, longest period 2^K frames (default off)\n"
+    "  --preaverage         merge from pre-averaged child directions\n"
+    "  --shared-tiles N     march up to N low cascades from shared-memory scene tiles (default 0)\n"
+    "  --sdf                sphere-trace intervals through a jump-flood distance field\n"
+    "  --occupancy          skip empty space with an occupancy mip pyramid\n"
+    "  --primitives N       scene of N drifting primitives, re-uploaded every run (default: circle)\n"
+    "  --reference-cascades N  full-image error of every configuration against an RGBA32F\n"
+    "                       reference-schedule run with N cascades (default: reduced formats and\n"
+    "                       schedules only, against their own cascade count)\n"
+    "  --csv                emit CSV instead of JSON\n"
+    "  --output PATH        write results to PATH instead of stdout\n",
+    argv0);
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+  auto parseInt   = [](const std::string& t, int& v)   { v = std::atoi(t.c_str()); return v > 0; };
+  auto parseFloat = [](const std::string& t, float& v) { v = float(std::atof(t.c_str())); return v > 0.0f; };
+  auto parseFormat = [](const std::string& t, RCStorageFormat& v) { return parseRCStorageFormat(t, v); };
+  auto parseSchedule = [](const std::string& t, RCStepSchedule& v) { return parseRCStepSchedule(t, v); };
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--resolutions" && hasValue)      { if (!parseList(argv[++i], o.resolutions, parseResolution)) return false; }
+    else if (a == "--cascades" && hasValue)    { if (!parseList(argv[++i], o.cascades, parseInt)) return false; }
+    else if (a == "--probe-sizes" && hasValue) { if (!parseList(argv[++i], o.probeSizes, parseInt)) return false; }
+    else if (a == "--intervals" && hasValue)   { if (!parseList(argv[++i], o.intervals, parseFloat)) return false; }
+    else if (a == "--formats" && hasValue)     { if (!parseList(argv[++i], o.formats, parseFormat)) return false; }
+    else if (a == "--schedules" && hasValue)   { if (!parseList(argv[++i], o.schedules, parseSchedule)) return false; }
+    else if (a == "--warmup" && hasValue)      { o.warmup = std::atoi(argv[++i]); }
+    else if (a == "--iterations" && hasValue)  { o.iterations = std::atoi(argv[++i]); }
+    else if (a == "--output" && hasValue)      { o.output = argv[++i]; }
+    else if (a == "--temporal" && hasValue)    { o.temporal.enabled = true; o.temporal.maxPeriodLog2 = std::atoi(argv[++i]); }
+    else if (a == "--preaverage")              { o.preaverage = true; }
+    else if (a == "--shared-tiles" && hasValue) { o.sharedTiles = std::atoi(argv[++i]); }
+    else if (a == "--sdf")                     { o.skipping = RCSpaceSkipping::DistanceField; }
+    else if (a == "--occupancy")               { o.skipping = RCSpaceSkipping::Occupancy; }
+    else if (a == "--primitives" && hasValue)  { o.primitives = std::atoi(argv[++i]); }
+    else if (a == "--reference-cascades" && hasValue) { o.referenceCascades = std::atoi(argv[++i]); }
+    else if (a == "--csv")                     { o.csv = true; }
+    else { std::fprintf(stderr, "unknown or incomplete option: %s\n", a.c_str()); return false; }
+  }
+  for (int c : o.cascades) if (c > kRCMaxCascades) { std::fprintf(stderr, "cascades must be <= %d\n", kRCMaxCascades); return false; }
+  if (o.referenceCascades < 0 || o.referenceCascades > kRCMaxCascades) { std::fprintf(stderr, "invalid --reference-cascades\n"); return false; }
+  return o.warmup >= 0 && o.iterations > 0 && o.primitives >= 0;
+}
+
+// JSON has no infinity; identical images (PSNR +inf) are written as null
+std::string psnrJson(double psnr) {
+  if (!std::isfinite(psnr)) return "null";
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.3f", psnr);
+  return buf;
+}
+
+void writeJson(FILE* f, const std::string& context, const Options& o, const std::vector<Result>& results) {
+  std::fprintf(f, "{\n  \"context\": \"%s\",\n  \"warmup\": %d,\n  \"iterations\": %d,\n"
+                  "  \"temporal_max_period_log2\": %d,\n  \"preaveraged_merge\": %s,\n"
+                  "  \"shared_tile_cascades\": %d,\n  \"space_skipping\": \"%s\",\n  \"scene_primitives\": %d,\n"
+                  "  \"results\": [\n",
+               context.c_str(), o.warmup, o.iterations, o.temporal.enabled ? o.temporal.maxPeriodLog2 : -1,
+               o.preaverage ? "true" : "false", o.sharedTiles,
+               rcSpaceSkippingName(o.skipping), o.primitives);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    std::fprintf(f, "    {\"width\": %d, \"height\": %d, \"cascades\": %d, \"probe_size\": %d, \"interval\": %g,"
+                    " \"format\": \"%s\", \"schedule\": \"%s\",\n"
+                    "     \"radial_error\": {\"max_abs\": %.6g, \"rms\": %.6g, \"max_rel\": %.6g},\n"
+                    "     \"image_error\": {\"rmse\": %.6g, \"max_abs\": %.6g, \"rel_l1\": %.6g, \"psnr\": %s},\n"
+                    "     \"steps_per_texel\": [",
+                 r.res.w, r.res.h, r.cascades, r.probeSize, r.interval, rcStorageFormatInfo(r.format).name,
+                 rcStepScheduleName(r.schedule).c_str(), r.error.max_abs, r.error.rms, r.error.max_rel,
+                 r.image.rmse, r.image.max_abs, r.image.rel_l1, psnrJson(r.image.psnr).c_str());
+    for (size_t c = 0; c < r.stepsPerTexel.size(); ++c) std::fprintf(f, "%s%.3f", c ? ", " : "", r.stepsPerTexel[c]);
+    std::fprintf(f, "],\n     \"stages\": {");
+    for (int m = 0; m < kMetricCount; ++m) {
+      std::fprintf(f, "%s\n       \"%s\": {\"min\": %.4f, \"median\": %.4f, \"p95\": %.4f}",
+                   m ? "," : "", kMetricNames[m], r.metrics[m].min, r.metrics[m].median, r.metrics[m].p95);
+    }
+    std::fprintf(f, "},\n     \"gpu_cascade_ms\": [");
+    for (size_t c = 0; c < r.cascade.size(); ++c) {
+      std::fprintf(f, "%s\n       {\"cascade\": %zu, \"min\": %.4f, \"median\": %.4f, \"p95\": %.4f}",
+                   c ? "," : "", c, r.cascade[c].min, r.cascade[c].median, r.cascade[c].p95);
+    }
+    std::fprintf(f, "]}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+}
+
+void writeCsv(FILE* f, const std::vector<Result>& results) {
+  std::fprintf(f, "width,height,cascades,probe_size,interval,format,schedule,metric,min,median,p95\n");
+  for (const Result& r : results) {
+    const char* fmt = rcStorageFormatInfo(r.format).name;
+    const std::string sched = rcStepScheduleName(r.schedule);
+    for (int m = 0; m < kMetricCount; ++m) {
+      std::fprintf(f, "%d,%d,%d,%d,%g,%s,%s,%s,%.4f,%.4f,%.4f\n",
+                   r.res.w, r.res.h, r.cascades, r.probeSize, r.interval, fmt, sched.c_str(), kMetricNames[m],
+                   r.metrics[m].min, r.metrics[m].median, r.metrics[m].p95);
+    }
+    for (size_t c = 0; c < r.cascade.size(); ++c) {
+      std::fprintf(f, "%d,%d,%d,%d,%g,%s,%s,gpu_cascade%zu_ms,%.4f,%.4f,%.4f\n",
+                   r.res.w, r.res.h, r.cascades, r.probeSize, r.interval, fmt, sched.c_str(), c,
+                   r.cascade[c].min, r.cascade[c].median, r.cascade[c].p95);
+    }
+    // Error and step rows carry a single value in all three columns
+    const double err[7] = {r.error.max_abs, r.error.rms, r.error.max_rel,
+                           r.image.rmse, r.image.max_abs, r.image.rel_l1, r.image.psnr};
+    const char* errName[7] = {"radial_err_max_abs", "radial_err_rms", "radial_err_max_rel",
+                              "image_err_rmse", "image_err_max_abs", "image_err_rel_l1", "image_err_psnr"};
+    for (int e = 0; e < 7; ++e) {
+      std::fprintf(f, "%d,%d,%d,%d,%g,%s,%s,%s,%.6g,%.6g,%.6g\n",
+                   r.res.w, r.res.h, r.cascades, r.probeSize, r.interval, fmt, sched.c_str(), errName[e],
+                   err[e], err[e], err[e]);
+    }
+    for (size_t c = 0; c < r.stepsPerTexel.size(); ++c) {
+      const double v = r.stepsPerTexel[c];
+      std::fprintf(f, "%d,%d,%d,%d,%g,%s,%s,steps_per_texel%zu,%.3f,%.3f,%.3f\n",
+                   r.res.w, r.res.h, r.cascades, r.probeSize, r.interval, fmt, sched.c_str(), c, v, v, v);
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  HeadlessGLContext ctx;
+  if (!ctx.initialize()) return 1;
+  const std::string context = HeadlessGLContext::describe();
+
+  RCGPURenderer renderer;
+  if (!renderer.initialize()) return 1;
+  renderer.setTemporalRefresh(opt.temporal);
+  renderer.setPreaveragedMerge(opt.preaverage);
+  renderer.setSharedSceneTiles(opt.sharedTiles);
+  renderer.setSpaceSkipping(opt.skipping);
+
+  AsyncStatsManager stats;
+  ReferenceImageError imageError;
+  Perf perf;
+  perf.init();
+
+  std::vector<Result> results;
+  std::vector<ScenePrimitive> prims;
+  int frame = 0;
+  for (const Resolution& res : opt.resolutions)
+  for (int cascades : opt.cascades)
+  for (int probeSize : opt.probeSizes)
+  for (float interval : opt.intervals)
+  for (RCStorageFormat format : opt.formats)
+  for (const RCStepSchedule& schedule : opt.schedules) {
+    const glm::ivec2 size(res.w, res.h);
+    renderer.setStorageFormat(format);
+    renderer.setStepSchedule(schedule);
+    const int max_radius = int(glm::length(glm::vec2(float(res.w), float(res.h)) * 0.5f));
+    stats.init(max_radius);
+
+    auto runOnce = [&]() {
+      if (opt.primitives > 0) {
+        makeDriftingPrimitives(prims, size_t(opt.primitives), size, float(frame++) / 60.0f);
+        renderer.setScenePrimitives(prims.data(), prims.size());
+      }
+      renderer.run_full_rc(probeSize, interval, cascades, size, &perf);
+      perf.beginCpuStats(); perf.beginGpuStats();
+      stats.dispatch_async(renderer.resultTex(), res.w, res.h);
+      perf.endGpuStats(); perf.endCpuStats();
+    };
+
+    for (int i = 0; i < opt.warmup; ++i) runOnce();
+    glFinish();
+
+    std::vector<double> samples[kMetricCount];
+    std::vector<std::vector<double>> cascadeSamples(size_t(std::min(cascades, kRCMaxCascades)));
+    for (auto& s : samples) s.reserve(size_t(opt.iterations));
+
+    for (int i = 0; i < opt.iterations; ++i) {
+      CpuTimer wall;
+      wall.start();
+      runOnce();
+      glFinish();
+      const double wall_ms = wall.stop_ms();
+      perf.resolveAll();
+
+      samples[kCpuScene].push_back(perf.cpu_scene_ms);
+      samples[kCpuCascades].push_back(perf.cpu_cascades_ms);
+      samples[kCpuBlit].push_back(perf.cpu_blit_ms);
+      samples[kCpuRC].push_back(perf.cpu_rc_ms);
+      samples[kCpuStats].push_back(perf.cpu_stats_ms);
+      samples[kGpuScene].push_back(perf.gpu_stages_last.scene_ms);
+      samples[kGpuClear].push_back(perf.gpu_stages_last.clear_ms);
+      samples[kGpuCascades].push_back(perf.gpu_stages_last.cascades_ms);
+      samples[kGpuBlit].push_back(perf.gpu_stages_last.blit_ms);
+      samples[kGpuRC].push_back(perf.gpu_rc_last_ms);
+      samples[kGpuStats].push_back(perf.gpu_stats_last_ms);
+      samples[kWall].push_back(wall_ms);
+      for (size_t c = 0; c < cascadeSamples.size(); ++c) {
+        cascadeSamples[c].push_back(perf.gpu_stages_last.cascade_ms[c]);
+      }
+    }
+
+    Result r{res, cascades, probeSize, interval, renderer.storageFormat(), renderer.stepSchedule(), {}, {}, {}, {}, {}};
+
+    // Counters perturb timing, so they get a run of their own
+    renderer.setStepCounters(true);
+    renderer.run_full_rc(probeSize, interval, cascades, size);
+    RCStepCounts counts;
+    if (renderer.readStepCounts(counts)) {
+      for (int c = 0; c < counts.cascades; ++c) {
+        r.stepsPerTexel.push_back(counts.texels[c] ? double(counts.steps[c]) / double(counts.texels[c]) : 0.0);
+      }
+    }
+    renderer.setStepCounters(false);
+
+    if (r.format != RCStorageFormat::RGBA32F || !(r.schedule == RCStepSchedule{})) {
+      if (!approximation_error(renderer, probeSize, interval, cascades, size, r.error)) {
+        std::fprintf(stderr, "radial error unavailable for %s\n", rcStorageFormatInfo(r.format).name);
+      }
+    }
+    if (opt.referenceCascades > 0 || r.format != RCStorageFormat::RGBA32F || !(r.schedule == RCStepSchedule{})) {
+      const int refCascades = opt.referenceCascades > 0 ? opt.referenceCascades : cascades;
+      imageError.measure(renderer, probeSize, interval, cascades, refCascades, size, r.image);
+    }
+    for (int m = 0; m < kMetricCount; ++m) r.metrics[m] = summarize(samples[m]);
+    for (const auto& c : cascadeSamples) r.cascade.push_back(summarize(c));
+    results.push_back(r);
+
+    std::fprintf(stderr, "%dx%d cascades=%d probe=%d interval=%g format=%s schedule=%s: wall median %.3f ms\n",
+                 res.w, res.h, cascades, probeSize, interval, rcStorageFormatInfo(r.format).name,
+                 rcStepScheduleName(r.schedule).c_str(),
+                 r.metrics[kWall].median);
+  }
+
+  FILE* f = opt.output.empty() ? stdout : std::fopen(opt.output.c_str(), "w");
+  if (!f) {
+    std::fprintf(stderr, "failed to open %s\n", opt.output.c_str());
+    return 1;
+  }
+  if (opt.csv) writeCsv(f, results);
+  else         writeJson(f, context, opt, results);
+  if (f != stdout) std::fclose(f);
+
+  stats.cleanup();
+  imageError.cleanup();
+  perf.shutdown();
+  return 0;
+}
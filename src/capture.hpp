@@ -0,0 +1,333 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "image_io.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+// Per-frame capture of the RC result (linear RGBA32F) and display image (RGBA8).
+// PFM/raw sequences write both images per frame; streams write one image per frame.
+enum class CaptureFormat {
+  PFMSequence,  // PREFIX_00000.pfm (linear) + PREFIX_00000.ppm (display)
+  RawSequence,  // PREFIX_00000.rgba32f + PREFIX_00000.rgba8, GL row order
+  Y4MStream,    // display as 8-bit 4:4:4 BT.709 video, top row first
+  RawStream,    // linear RGBA32F frames back to back, GL row order
+};
+
+struct CaptureSettings {
+  CaptureFormat format = CaptureFormat::PFMSequence;
+  std::string path;       // sequence prefix, or stream file ("-" = stdout)
+  int ringSize = 4;       // readbacks in flight or being written
+  int fps = 60;           // Y4M header rate
+};
+
+inline const char* captureFormatName(CaptureFormat f) {
+  switch (f) {
+    case CaptureFormat::PFMSequence: return "pfm";
+    case CaptureFormat::RawSequence: return "raw";
+    case CaptureFormat::Y4MStream:   return "y4m";
+    case CaptureFormat::RawStream:   return "raw-stream";
+  }
+  return "?";
+}
+
+inline bool parseCaptureFormat(const std::string& name, CaptureFormat& out) {
+  for (CaptureFormat f : {CaptureFormat::PFMSequence, CaptureFormat::RawSequence,
+                          CaptureFormat::Y4MStream, CaptureFormat::RawStream}) {
+    if (name == captureFormatName(f)) { out = f; return true; }
+  }
+  return false;
+}
+
+// Never reads back synchronously: capture() queues glGetTexImage into a slot of a ring of
+// persistently mapped pixel-pack buffers and fences it. Later calls hand slots whose fence has
+// passed to an I/O thread, which writes straight from the mapping and then frees the slot.
+// capture() only blocks when the ring is full (counted in ringStalls()).
+class FrameCapture {
+public:
+  FrameCapture() = default;
+  ~FrameCapture() { end(); }
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  bool begin(const CaptureSettings& settings, const glm::ivec2& res) {
+    end();
+    settings_ = settings;
+    res_ = res;
+    const size_t texels = size_t(res.x) * size_t(res.y);
+    linear_bytes_  = wantsLinear_() ? texels * 16u : 0;
+    display_bytes_ = wantsDisplay_() ? texels * 4u : 0;
+
+    if (isStream_()) {
+      if (settings_.path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        stream_ = stdout;
+      } else {
+        stream_ = std::fopen(settings_.path.c_str(), "wb");
+      }
+      if (!stream_) {
+        std::cerr << "Failed to open capture stream " << settings_.path << "\n";
+        return false;
+      }
+      if (settings_.format == CaptureFormat::Y4MStream) {
+        std::fprintf(stream_, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", res.x, res.y, settings_.fps);
+      }
+    }
+
+    const int n = std::max(settings_.ringSize, 2);
+    const GLsizeiptr bytes = GLsizeiptr(linear_bytes_ + display_bytes_);
+    const bool persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    slots_.assign(size_t(n), Slot{});
+    for (Slot& s : slots_) {
+      if (persistent) {
+        resources_.ensureBuffer(s.pbo, bytes, flags);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        s.mapped = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, flags));
+      } else {
+        resources_.ensureBuffer(s.pbo, bytes, 0);
+      }
+      if (!s.mapped) s.staging.resize(size_t(bytes));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    next_frame_ = 0;
+    frames_written_ = 0;
+    ring_stalls_ = 0;
+    failed_ = false;
+    stop_ = false;
+    active_ = true;
+    io_thread_ = std::thread([this] { ioLoop_(); });
+    return true;
+  }
+
+  bool active() const { return active_; }
+
+  // Queue the readback of this frame's textures (res x res, any float/8-bit RGBA format)
+  void capture(GLuint linearTex, GLuint displayTex) {
+    if (!active_) return;
+    collect_(false);
+    Slot& s = slots_[size_t(next_frame_ % uint64_t(slots_.size()))];
+    if (stateOf_(s) != Slot::Free) {
+      ++ring_stalls_;
+      while (stateOf_(s) == Slot::InFlight) collect_(true);
+      std::unique_lock<std::mutex> lock(mutex_);
+      freed_.wait(lock, [&] { return s.state == Slot::Free; });
+    }
+
+    // Written by compute (imageStore) and blits; make them visible to the pack
+    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if (linear_bytes_) {
+      glBindTexture(GL_TEXTURE_2D, linearTex);
+      glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    if (display_bytes_) {
+      glBindTexture(GL_TEXTURE_2D, displayTex);
+      glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(linear_bytes_));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = next_frame_++;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      s.state = Slot::InFlight;
+    }
+    in_flight_.push_back(&s);
+  }
+
+  // Write every queued frame, stop the I/O thread and close the stream. Returns false if any
+  // write failed.
+  bool end() {
+    if (!active_) return !failed_;
+    while (!in_flight_.empty()) collect_(true);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    io_thread_.join();
+
+    if (stream_) {
+      if (std::fflush(stream_) != 0) failed_ = true;
+      if (stream_ != stdout && std::fclose(stream_) != 0) failed_ = true;
+      stream_ = nullptr;
+    }
+    for (Slot& s : slots_) {
+      if (s.mapped) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      }
+      resources_.releaseBuffer(s.pbo);
+    }
+    slots_.clear();
+    active_ = false;
+    return !failed_;
+  }
+
+  uint64_t framesWritten() const { return frames_written_; }
+  // capture() calls that waited for a ring slot (readback or I/O slower than rendering)
+  uint64_t ringStalls() const { return ring_stalls_; }
+
+private:
+  struct Slot {
+    enum State { Free, InFlight, Writing };
+    GLuint pbo = 0;
+    const uint8_t* mapped = nullptr;  // persistent coherent mapping, or null (staging copy)
+    std::vector<uint8_t> staging;
+    GLsync fence = nullptr;
+    uint64_t frame = 0;
+    State state = Free;  // guarded by mutex_ once the I/O thread runs
+    const uint8_t* data() const { return mapped ? mapped : staging.data(); }
+  };
+
+  CaptureSettings settings_;
+  glm::ivec2 res_{0, 0};
+  size_t linear_bytes_ = 0, display_bytes_ = 0;
+  GpuResourceManager resources_;
+  std::vector<Slot> slots_;
+  std::deque<Slot*> in_flight_;  // GL thread only, oldest first
+  std::deque<Slot*> writable_;   // guarded by mutex_
+  std::mutex mutex_;
+  std::condition_variable ready_, freed_;
+  std::thread io_thread_;
+  FILE* stream_ = nullptr;
+  uint64_t next_frame_ = 0, ring_stalls_ = 0;
+  std::atomic<uint64_t> frames_written_{0};  // bumped by the I/O thread, read from the GL thread
+  bool failed_ = false, stop_ = false, active_ = false;
+
+  bool isStream_() const {
+    return settings_.format == CaptureFormat::Y4MStream || settings_.format == CaptureFormat::RawStream;
+  }
+  bool wantsLinear_() const  { return settings_.format != CaptureFormat::Y4MStream; }
+  bool wantsDisplay_() const { return settings_.format != CaptureFormat::RawStream; }
+
+  Slot::State stateOf_(const Slot& s) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return s.state;
+  }
+
+  // Hand finished readbacks to the I/O thread in frame order; 'wait' blocks on the oldest
+  void collect_(bool wait) {
+    while (!in_flight_.empty()) {
+      Slot& s = *in_flight_.front();
+      const GLuint64 timeout = wait ? 1000000000ull : 0ull;
+      const GLenum r = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+      if (r == GL_TIMEOUT_EXPIRED) {
+        if (wait) continue;
+        return;
+      }
+      glDeleteSync(s.fence);
+      s.fence = nullptr;
+      if (!s.mapped) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(s.staging.size()), s.staging.data());
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      }
+      in_flight_.pop_front();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.state = Slot::Writing;
+        writable_.push_back(&s);
+      }
+      ready_.notify_one();
+      if (wait) return;
+    }
+  }
+
+  void ioLoop_() {
+    std::vector<uint8_t> planes;
+    for (;;) {
+      Slot* s = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_.wait(lock, [&] { return stop_ || !writable_.empty(); });
+        if (writable_.empty()) return;
+        s = writable_.front();
+        writable_.pop_front();
+      }
+      const bool ok = write_(*s, planes);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ok) failed_ = true;
+        ++frames_written_;
+        s->state = Slot::Free;
+      }
+      freed_.notify_all();
+    }
+  }
+
+  bool write_(const Slot& s, std::vector<uint8_t>& planes) {
+    const uint8_t* linear  = s.data();
+    const uint8_t* display = s.data() + linear_bytes_;
+    char name[32];
+    std::snprintf(name, sizeof(name), "_%05llu", (unsigned long long)s.frame);
+    const std::string prefix = settings_.path + name;
+    switch (settings_.format) {
+      case CaptureFormat::PFMSequence:
+        return writePFM(prefix + ".pfm", res_.x, res_.y, reinterpret_cast<const float*>(linear)) &&
+               writePPM(prefix + ".ppm", res_.x, res_.y, display);
+      case CaptureFormat::RawSequence:
+        return writeRaw_(prefix + ".rgba32f", linear, linear_bytes_) &&
+               writeRaw_(prefix + ".rgba8", display, display_bytes_);
+      case CaptureFormat::RawStream:
+        return std::fwrite(linear, 1, linear_bytes_, stream_) == linear_bytes_;
+      case CaptureFormat::Y4MStream:
+        toYUV444_(display, planes);
+        return std::fputs("FRAME\n", stream_) >= 0 &&
+               std::fwrite(planes.data(), 1, planes.size(), stream_) == planes.size();
+    }
+    return false;
+  }
+
+  static bool writeRaw_(const std::string& path, const uint8_t* data, size_t bytes) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const bool ok = std::fwrite(data, 1, bytes, f) == bytes;
+    return (std::fclose(f) == 0) && ok;
+  }
+
+  // sRGB-encoded RGBA8 (GL row order) to limited-range BT.709 Y, Cb, Cr planes, top row first
+  void toYUV444_(const uint8_t* rgba, std::vector<uint8_t>& planes) const {
+    const size_t texels = size_t(res_.x) * size_t(res_.y);
+    planes.resize(texels * 3u);
+    uint8_t* y = planes.data();
+    uint8_t* u = y + texels;
+    uint8_t* v = u + texels;
+    for (int row = 0; row < res_.y; ++row) {
+      const uint8_t* src = rgba + size_t(res_.y - 1 - row) * size_t(res_.x) * 4u;
+      const size_t o = size_t(row) * size_t(res_.x);
+      for (int x = 0; x < res_.x; ++x) {
+        const float r = src[4 * x], g = src[4 * x + 1], b = src[4 * x + 2];
+        const float luma = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+        y[o + size_t(x)] = uint8_t(16.0f + luma * (219.0f / 255.0f) + 0.5f);
+        u[o + size_t(x)] = uint8_t(std::clamp(128.0f + (b - luma) / 1.8556f * (224.0f / 255.0f) + 0.5f, 0.0f, 255.0f));
+        v[o + size_t(x)] = uint8_t(std::clamp(128.0f + (r - luma) / 1.5748f * (224.0f / 255.0f) + 0.5f, 0.0f, 255.0f));
+      }
+    }
+  }
+};
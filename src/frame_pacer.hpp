@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "perf.hpp"
+
+// Bounds how far the GPU may run behind the CPU: every frame is fenced after submission, and
+// beginFrame() waits on the oldest fence while maxFramesInFlight() frames are still pending.
+// With vsync off the driver would otherwise queue frames freely, so latency grows and the
+// timings describe bursts rather than sustained throughput.
+class FramePacer {
+public:
+  static constexpr int kMaxFramesInFlight = 3;
+
+  FramePacer() = default;
+  ~FramePacer() { reset(); }
+
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  // 1..kMaxFramesInFlight; lowering it takes effect at the next beginFrame()
+  void setMaxFramesInFlight(int n) { max_ = std::clamp(n, 1, kMaxFramesInFlight); }
+  int  maxFramesInFlight() const { return max_; }
+
+  // Call before recording a frame's GL work
+  void beginFrame() {
+    CpuTimer timer;
+    timer.start();
+    bool waited = false;
+    // Retire finished frames without blocking, then block on the oldest while over the cap
+    while (count_ > 0 && glClientWaitSync(fences_[head_], 0, 0) != GL_TIMEOUT_EXPIRED) pop_();
+    while (count_ >= max_) {
+      waited = true;
+      while (glClientWaitSync(fences_[head_], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+      pop_();
+    }
+    wait_ms_ = timer.stop_ms();
+    if (waited) ++stalls_;
+  }
+
+  // Call after the frame's last submission (after the buffer swap)
+  void endFrame() {
+    if (count_ == kMaxFramesInFlight) pop_();  // only reachable if beginFrame() was skipped
+    fences_[(head_ + count_) % kMaxFramesInFlight] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++count_;
+  }
+
+  // Drop all fences (e.g. before destroying the context)
+  void reset() {
+    while (count_ > 0) pop_();
+    head_ = 0;
+  }
+
+  int      framesInFlight() const { return count_; }
+  double   lastWaitMs() const { return wait_ms_; }  // CPU time beginFrame() spent blocked
+  uint64_t stalls() const { return stalls_; }       // frames that had to wait for the GPU
+
+private:
+  GLsync   fences_[kMaxFramesInFlight] = {};
+  int      head_ = 0, count_ = 0;
+  int      max_ = 2;
+  double   wait_ms_ = 0.0;
+  uint64_t stalls_ = 0;
+
+  void pop_() {
+    glDeleteSync(fences_[head_]);
+    fences_[head_] = nullptr;
+    head_ = (head_ + 1) % kMaxFramesInFlight;
+    --count_;
+  }
+};
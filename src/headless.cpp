@@ -0,0 +1,455 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "headless_context.hpp"
+#include "rc.hpp"
+#include "perf.hpp"
+#include "texture.hpp"
+#include "image_io.hpp"
+#include "validate.hpp"
+#include "capture.hpp"
+#include "reference.hpp"
+
+// Headless Radiance Cascades runner.
+// Creates a windowless EGL context, runs RCGPURenderer::run_full_rc for the requested
+// configuration and writes the linear result (PFM), the sRGB display image (PPM) and timings.
+// No window, no UI and no vsync, so timings reflect the RC workload only.
+// With --dirty, one full run primes the cascades; each timed iteration then paints an emissive
+// box into every dirty rect of the scene and updates the cascades with run_dirty_rc.
+// With --temporal, run_full_rc refreshes upper cascades in staggered bands (see RCTemporalSettings).
+// With --cpu, RCCPURenderer runs instead and no GL context is created (machines without a GPU).
+
+namespace {
+
+struct Options {
+  int   width        = 512;
+  int   height       = 512;
+  int   cascades     = 8;
+  int   probeSize    = 1;
+  float interval     = 0.2f;
+  int   iterations   = 1;
+  std::string out    = "rc_out";
+  bool  write        = true;
+  bool  validate     = false;
+  float tolerance    = 1e-3f;
+  std::vector<RCRect> dirty;
+  RCTemporalSettings temporal;
+  RCStorageFormat format = RCStorageFormat::RGBA32F;
+  bool  preaverage   = false;
+  int   sharedTiles  = 0;
+  RCSpaceSkipping skipping = RCSpaceSkipping::None;
+  RCStepSchedule schedule;
+  bool  stepCounters = false;
+  int   primitives   = 0;
+  int   referenceCascades = 0;  // > 0: report the full-image error against this many cascades
+  int   referenceRays = 0;      // > 0: report the error against the brute-force reference
+  float referenceStep = 0.25f;
+  std::vector<std::string> scenes;  // scene image sequence, one file per iteration (cycled)
+  bool  capture      = false;
+  CaptureSettings captureSettings;
+  std::string shaderCache;  // program binary directory; empty = compile every run
+  bool  cpu          = false;
+  unsigned threads   = 0;     // --cpu worker threads; 0 = hardware concurrency
+};
+
+void printUsage(const char* argv0) {
+  std::fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --width N          output width in pixels (default 512)\n"
+    "  --height N         output height in pixels (default 512)\n"
+    "  --cascades N       number of cascades (default 8)\n"
+    "  --probe-size N     base probe size (default 1)\n"
+    "  --interval F       base interval length (default 0.2)\n"
+    "  --iterations N     number of run_full_rc calls (default 1)\n"
+    "  --out PREFIX       output prefix; writes PREFIX.pfm and PREFIX.ppm (default rc_out)\n"
+    "  --no-write         skip writing images\n"
+    "  --validate [TOL]   diff the GPU result against the CPU reference (default tol 1e-3);\n"
+    "                     with --temporal, run enough iterations for every band to settle\n"
+    "                     with --dirty, against a full GPU recompute of the same scene\n"
+    "  --dirty X,Y,W,H    incremental mode: repaint this rect each iteration (repeatable)\n"
+    "  --temporal [K]     staggered refresh, longest cascade period 2^K frames (default 3)\n"
+    "  --format NAME      cascade storage: rgba32f (default), rgba16f, r11g11b10f_r8,\n"
+    "                     r11g11b10f_r16, rgb9e5_r16; reduced formats report their error\n"
+    "  --preaverage       merge from pre-averaged child directions (4 fetches instead of 16)\n"
+    "  --shared-tiles N   march up to N low cascades from shared-memory scene tiles (default 0)\n"
+    "  --sdf              sphere-trace intervals through a jump-flood distance field\n"
+    "  --occupancy        skip empty space with an occupancy mip pyramid\n"
+    "  --schedule NAME    interval traversal: reference (default), per-pixel[:N], dda;\n"
+    "                     non-reference schedules report their error\n"
+    "  --reference-cascades N  also report the full-image error (GPU-reduced RMSE, max abs,\n"
+    "                     relative L1, PSNR) against an RGBA32F reference-schedule run with N\n"
+    "                     cascades; reduced formats and schedules report it against --cascades\n"
+    "  --reference-rays N report the full-image error against a brute-force reference of N\n"
+    "                     stratified rays per pixel through the final scene (any scene)\n"
+    "  --reference-step F march step of the brute-force reference in pixels (default 0.25)\n"
+    "  --step-counters    print march iterations per cascade texel of the last run\n"
+    "  --primitives N     scene of N drifting circles/boxes/segments, moved every iteration;\n"
+    "                     --validate then checks the tile-binned scene against an unbinned one\n"
+    "  --scene PATH       scene from a raw RGBA32F, PFM or 8-bit PNG file (repeatable: a sequence\n"
+    "                     streamed one file per iteration); --validate then checks the uploaded\n"
+    "                     scene against a CPU decode of the last file\n"
+    "  --capture FMT:PATH capture every iteration without stalling: pfm:PREFIX or raw:PREFIX\n"
+    "                     (linear + display images per frame), y4m:FILE (display video) or\n"
+    "                     raw-stream:FILE (linear frames); FILE '-' is stdout (report goes to stderr)\n"
+    "  --shader-cache DIR load compiled programs from DIR and save new ones there, so later\n"
+    "                     runs skip the GLSL compiler\n"
+    "  --cpu              run the CPU reference renderer without creating a GL context and\n"
+    "                     write PREFIX.pfm only (built-in scene; GPU-only options are ignored)\n"
+    "  --threads N        worker threads for --cpu (default: hardware concurrency)\n",
+    argv0);
+}
+
+bool parseArgs(int argc, char** argv, Options& o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string a = argv[i];
+    auto next = [&](const char* name) -> const char* {
+      if (i + 1 >= argc) { std::fprintf(stderr, "missing value for %s\n", name); return nullptr; }
+      return argv[++i];
+    };
+    const char* v = nullptr;
+    if (a == "--width")           { if (!(v = next("--width")))      return false; o.width      = std::atoi(v); }
+    else if (a == "--height")     { if (!(v = next("--height")))     return false; o.height     = std::atoi(v); }
+    else if (a == "--cascades")   { if (!(v = next("--cascades")))   return false; o.cascades   = std::atoi(v); }
+    else if (a == "--probe-size") { if (!(v = next("--probe-size"))) return false; o.probeSize  = std::atoi(v); }
+    else if (a == "--interval")   { if (!(v = next("--interval")))   return false; o.interval   = float(std::atof(v)); }
+    else if (a == "--iterations") { if (!(v = next("--iterations"))) return false; o.iterations = std::atoi(v); }
+    else if (a == "--out")        { if (!(v = next("--out")))        return false; o.out        = v; }
+    else if (a == "--no-write")   { o.write = false; }
+    else if (a == "--cpu")        { o.cpu = true; }
+    else if (a == "--threads")    { if (!(v = next("--threads")))    return false; o.threads    = unsigned(std::max(std::atoi(v), 0)); }
+    else if (a == "--preaverage") { o.preaverage = true; }
+    else if (a == "--shared-tiles") { if (!(v = next("--shared-tiles"))) return false; o.sharedTiles = std::atoi(v); }
+    else if (a == "--sdf")        { o.skipping = RCSpaceSkipping::DistanceField; }
+    else if (a == "--occupancy")  { o.skipping = RCSpaceSkipping::Occupancy; }
+    else if (a == "--step-counters") { o.stepCounters = true; }
+    else if (a == "--capture") {
+      if (!(v = next("--capture"))) return false;
+      const std::string spec = v;
+      const size_t colon = spec.find(':');
+      if (colon == std::string::npos || colon + 1 == spec.size() ||
+          !parseCaptureFormat(spec.substr(0, colon), o.captureSettings.format)) {
+        std::fprintf(stderr, "invalid --capture: %s\n", v);
+        return false;
+      }
+      o.captureSettings.path = spec.substr(colon + 1);
+      o.capture = true;
+    }
+    else if (a == "--scene")      { if (!(v = next("--scene"))) return false; o.scenes.push_back(v); }
+    else if (a == "--reference-cascades") {
+      if (!(v = next("--reference-cascades"))) return false;
+      o.referenceCascades = std::atoi(v);
+    }
+    else if (a == "--reference-rays") {
+      if (!(v = next("--reference-rays"))) return false;
+      o.referenceRays = std::atoi(v);
+    }
+    else if (a == "--reference-step") {
+      if (!(v = next("--reference-step"))) return false;
+      o.referenceStep = float(std::atof(v));
+    }
+    else if (a == "--shader-cache") { if (!(v = next("--shader-cache"))) return false; o.shaderCache = v; }
+    else if (a == "--primitives") { if (!(v = next("--primitives"))) return false; o.primitives = std::atoi(v); }
+    else if (a == "--schedule") {
+      if (!(v = next("--schedule"))) return false;
+      if (!parseRCStepSchedule(v, o.schedule)) { std::fprintf(stderr, "unknown schedule: %s\n", v); return false; }
+    }
+    else if (a == "--format") {
+      if (!(v = next("--format"))) return false;
+      if (!parseRCStorageFormat(v, o.format)) { std::fprintf(stderr, "unknown format: %s\n", v); return false; }
+    }
+    else if (a == "--temporal") {
+      o.temporal.enabled = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') o.temporal.maxPeriodLog2 = std::atoi(argv[++i]);
+    }
+    else if (a == "--dirty") {
+      if (!(v = next("--dirty"))) return false;
+      RCRect r;
+      if (std::sscanf(v, "%d,%d,%d,%d", &r.x, &r.y, &r.w, &r.h) != 4 || r.empty()) {
+        std::fprintf(stderr, "invalid --dirty rect: %s\n", v);
+        return false;
+      }
+      o.dirty.push_back(r);
+    }
+    else if (a == "--validate") {
+      o.validate = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') o.tolerance = float(std::atof(argv[++i]));
+    }
+    else if (a == "--help" || a == "-h") { return false; }
+    else { std::fprintf(stderr, "unknown option: %s\n", a.c_str()); return false; }
+  }
+  if (o.width <= 0 || o.height <= 0 || o.cascades <= 0 || o.cascades > kRCMaxCascades ||
+      o.probeSize <= 0 || o.interval <= 0.0f || o.iterations <= 0 || o.primitives < 0 ||
+      o.referenceCascades < 0 || o.referenceCascades > kRCMaxCascades ||
+      o.referenceRays < 0 || o.referenceStep <= 0.0f) {
+    std::fprintf(stderr, "invalid configuration\n");
+    return false;
+  }
+  return true;
+}
+
+// Fill the (clipped) rects of the scene with an emissive color; the GPU-side equivalent of a
+// small scene edit.
+bool paintScene(GLuint sceneTex, const glm::ivec2& res, const std::vector<RCRect>& rects, const float color[4]) {
+  if (!GLEW_VERSION_4_4 && !GLEW_ARB_clear_texture) {
+    std::fprintf(stderr, "--dirty needs glClearTexSubImage (GL 4.4 or ARB_clear_texture)\n");
+    return false;
+  }
+  for (const RCRect& r : rects) {
+    const int x0 = std::max(r.x, 0), y0 = std::max(r.y, 0);
+    const int x1 = std::min(r.x + r.w, res.x), y1 = std::min(r.y + r.h, res.y);
+    if (x1 <= x0 || y1 <= y0) continue;
+    glClearTexSubImage(sceneTex, 0, x0, y0, 0, x1 - x0, y1 - y0, 1, GL_RGBA, GL_FLOAT, color);
+  }
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  return true;
+}
+
+// --cpu: the whole run on RCCPURenderer; nothing here touches GL
+int runCPU(const Options& opt) {
+  const glm::ivec2 res(opt.width, opt.height);
+  RCCPURenderer cpu(opt.threads);
+  double wall_sum = 0.0;
+  for (int it = 0; it < opt.iterations; ++it) {
+    CpuTimer wall;
+    wall.start();
+    cpu.run_full_rc(opt.probeSize, opt.interval, opt.cascades, res);
+    wall_sum += wall.stop_ms();
+  }
+  std::printf("context: none (cpu)\n");
+  std::printf("config: %dx%d cascades=%d probe=%d interval=%g iterations=%d threads=%u\n",
+              opt.width, opt.height, opt.cascades, opt.probeSize, opt.interval, opt.iterations, opt.threads);
+  std::printf("cpu_rc_ms: %.3f\n", wall_sum / double(opt.iterations));
+
+  if (opt.write) {
+    const std::string pfm = opt.out + ".pfm";
+    if (!writePFM(pfm, res.x, res.y, cpu.result().texels.data())) {
+      std::fprintf(stderr, "failed to write %s\n", pfm.c_str());
+      return 1;
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+  if (opt.cpu) return runCPU(opt);
+  // A capture stream on stdout owns it; the report moves to stderr
+  FILE* report = (opt.capture && opt.captureSettings.path == "-") ? stderr : stdout;
+
+  HeadlessGLContext ctx;
+  if (!ctx.initialize()) return 1;
+  std::fprintf(report, "context: %s\n", HeadlessGLContext::describe().c_str());
+  ProgramCache::shared().setDirectory(opt.shaderCache);
+
+  CpuTimer startup;
+  startup.start();
+  RCGPURenderer renderer;
+  if (!renderer.initialize()) return 1;
+  std::fprintf(report, "startup: %.2f ms\n", startup.stop_ms());
+  renderer.setTemporalRefresh(opt.temporal);
+  renderer.setStorageFormat(opt.format);
+  renderer.setPreaveragedMerge(opt.preaverage);
+  renderer.setSharedSceneTiles(opt.sharedTiles);
+  renderer.setSpaceSkipping(opt.skipping);
+  renderer.setStepSchedule(opt.schedule);
+  renderer.setStepCounters(opt.stepCounters);
+
+  Perf perf;
+  perf.init();
+
+  const glm::ivec2 res(opt.width, opt.height);
+  const bool incremental = !opt.dirty.empty();
+  std::vector<ScenePrimitive> prims;
+  auto movePrimitives = [&](int frame) {
+    if (opt.primitives == 0) return;
+    makeDriftingPrimitives(prims, size_t(opt.primitives), res, float(frame) / 60.0f);
+    renderer.setScenePrimitives(prims.data(), prims.size());
+  };
+  double cpu_sum = 0.0, gpu_sum = 0.0, wall_sum = 0.0, coverage_sum = 0.0;
+
+  // Each file is decoded into an upload buffer right after the previous run was submitted
+  auto loadScene = [&](int frame) {
+    if (opt.scenes.empty()) return true;
+    return renderer.loadSceneImage(opt.scenes[size_t(frame) % opt.scenes.size()], res);
+  };
+  if (!loadScene(0)) return 1;
+  movePrimitives(0);
+  FrameCapture capture;
+  if (opt.capture && !capture.begin(opt.captureSettings, res)) return 1;
+  if (incremental) {
+    renderer.run_full_rc(opt.probeSize, opt.interval, opt.cascades, res);
+    glFinish();
+  }
+
+  for (int it = 0; it < opt.iterations; ++it) {
+    CpuTimer wall;
+    wall.start();
+    if (incremental) {
+      // Alternate colors so every iteration really changes the scene
+      const float color[4] = {1.0f, (it & 1) ? 0.25f : 0.75f, 0.1f, 1.0f};
+      if (!paintScene(renderer.sceneTex(), res, opt.dirty, color)) return 1;
+      renderer.run_dirty_rc(opt.probeSize, opt.interval, opt.cascades, res, opt.dirty, &perf);
+    } else {
+      movePrimitives(it);
+      renderer.run_full_rc(opt.probeSize, opt.interval, opt.cascades, res, &perf);
+      if (it + 1 < opt.iterations && !loadScene(it + 1)) return 1;
+    }
+    capture.capture(renderer.resultTex(), renderer.displayTex());
+    glFinish();
+    const double wall_ms = wall.stop_ms();
+
+    perf.resolveAll();
+    cpu_sum      += perf.cpu_rc_ms;
+    gpu_sum      += perf.gpu_rc_last_ms;
+    wall_sum     += wall_ms;
+    coverage_sum += renderer.lastUpdateCoverage();
+  }
+
+  int status = 0;
+  if (capture.active()) {
+    CpuTimer drain;
+    drain.start();
+    if (!capture.end()) { std::fprintf(stderr, "capture: write failed\n"); status = 1; }
+    std::fprintf(report, "capture: format=%s frames=%llu ring_stalls=%llu drain_ms=%.3f\n",
+                 captureFormatName(opt.captureSettings.format), (unsigned long long)capture.framesWritten(),
+                 (unsigned long long)capture.ringStalls(), drain.stop_ms());
+  }
+
+  const double n = double(opt.iterations);
+  std::fprintf(report, "config: %dx%d cascades=%d probe=%d interval=%g iterations=%d format=%s preaverage=%d shared_tile_cascades=%d skip=%s schedule=%s\n",
+              opt.width, opt.height, opt.cascades, opt.probeSize, opt.interval, opt.iterations,
+              rcStorageFormatInfo(renderer.storageFormat()).name, renderer.preaveragedMerge() ? 1 : 0,
+              renderer.sharedTileCascades(), rcSpaceSkippingName(renderer.spaceSkipping()),
+              rcStepScheduleName(renderer.stepSchedule()).c_str());
+  if (opt.primitives > 0) std::fprintf(report, "primitives: %d\n", opt.primitives);
+  if (!opt.scenes.empty()) std::fprintf(report, "scene_files: %zu\n", opt.scenes.size());
+  std::fprintf(report, "cpu_rc_ms: %.3f\n", cpu_sum / n);
+  std::fprintf(report, "gpu_rc_ms: %.3f\n", gpu_sum / n);
+  std::fprintf(report, "wall_ms: %.3f\n", wall_sum / n);
+  if (incremental || opt.temporal.enabled) std::fprintf(report, "update_coverage: %.4f\n", coverage_sum / n);
+
+  RCStepCounts counts;
+  if (renderer.readStepCounts(counts)) {
+    for (int i = 0; i < counts.cascades; ++i) {
+      const double perTexel = counts.texels[i] ? double(counts.steps[i]) / double(counts.texels[i]) : 0.0;
+      std::fprintf(report, "steps[%d]: total=%llu per_texel=%.2f\n", i, (unsigned long long)counts.steps[i], perTexel);
+    }
+  }
+
+  const bool approximate = renderer.storageFormat() != RCStorageFormat::RGBA32F ||
+                           !(renderer.stepSchedule() == RCStepSchedule{});
+  if (approximate && !incremental) {
+    // Before writing, so the images come from the last run in the requested configuration
+    RadialStatsError e;
+    if (approximation_error(renderer, opt.probeSize, opt.interval, opt.cascades, res, e)) {
+      std::fprintf(report, "approx_error: max_abs=%.6g rms=%.6g max_rel=%.6g bins=%d\n", e.max_abs, e.rms, e.max_rel, e.bins);
+    } else {
+      std::fprintf(stderr, "approximation error unavailable (radial stats could not be measured)\n");
+    }
+  }
+  if ((approximate || opt.referenceCascades > 0) && !incremental) {
+    const int refCascades = opt.referenceCascades > 0 ? opt.referenceCascades : opt.cascades;
+    ReferenceImageError probe;
+    ImageErrorMetrics m;
+    if (probe.measure(renderer, opt.probeSize, opt.interval, opt.cascades, refCascades, res, m)) {
+      std::fprintf(report, "image_error: reference_cascades=%d rmse=%.6g max_abs=%.6g rel_l1=%.6g psnr=%.3f\n",
+                   refCascades, m.rmse, m.max_abs, m.rel_l1, m.psnr);
+    }
+  }
+  if (opt.referenceRays > 0) {
+    // The last run left the scene and result of the requested configuration in place
+    RCReferenceIntegrator reference;
+    AsyncErrorMetrics metrics;
+    RCReferenceSettings rs;
+    rs.raysPerPass = std::min(opt.referenceRays, 16);
+    rs.targetRays  = opt.referenceRays;
+    rs.stepLength  = opt.referenceStep;
+    reference.setSettings(rs);
+    CpuTimer timer;
+    timer.start();
+    if (reference.initialize() && metrics.init()) {
+      while (reference.advance(renderer.sceneTex(), res)) {}
+      // Radiance only: the reference alpha is the mean transmittance over all directions
+      metrics.dispatch_async(renderer.resultTex(), reference.resultTex(), res.x, res.y, 3);
+      ImageErrorMetrics m;
+      if (metrics.try_read(m, true)) {
+        std::fprintf(report, "reference_error: rays=%llu step=%g rmse=%.6g max_abs=%.6g rel_l1=%.6g psnr=%.3f ms=%.1f\n",
+                     (unsigned long long)reference.raysPerPixel(), opt.referenceStep, m.rmse, m.max_abs, m.rel_l1,
+                     m.psnr, timer.stop_ms());
+      }
+    }
+  }
+
+  if (opt.write) {
+    std::vector<float> linear;
+    std::vector<uint8_t> display;
+    readTexture2D(renderer.resultTex(), res.x, res.y, linear);
+    readTexture2D(renderer.displayTex(), res.x, res.y, display);
+    const std::string pfm = opt.out + ".pfm";
+    const std::string ppm = opt.out + ".ppm";
+    if (!writePFM(pfm, res.x, res.y, linear.data()))  { std::fprintf(stderr, "failed to write %s\n", pfm.c_str()); status = 1; }
+    if (!writePPM(ppm, res.x, res.y, display.data())) { std::fprintf(stderr, "failed to write %s\n", ppm.c_str()); status = 1; }
+  }
+
+  if (opt.validate) {
+    ImageDiff d;
+    if (incremental) {
+      // Same scene, every probe recomputed: incremental updates must match it exactly
+      std::vector<float> partial, full;
+      readTexture2D(renderer.resultTex(), res.x, res.y, partial);
+      renderer.run_dirty_rc(opt.probeSize, opt.interval, opt.cascades, res, {RCRect{0, 0, res.x, res.y}});
+      readTexture2D(renderer.resultTex(), res.x, res.y, full);
+      d = diffRGBA32F(partial, full, res.x, res.y, opt.tolerance);
+    } else if (!opt.scenes.empty()) {
+      // The CPU reference only knows the built-in circle; the upload must reproduce the file
+      const std::string& path = opt.scenes[size_t(opt.iterations - 1) % opt.scenes.size()];
+      MappedFile file;
+      SceneImageInfo info;
+      std::vector<float> uploaded, decoded(size_t(res.x) * size_t(res.y) * 4u);
+      if (!file.open(path) || !inspectSceneImage(file.data(), file.size(), res.x, res.y, info) ||
+          info.width != res.x || info.height != res.y || !decodeSceneImage(file.data(), file.size(), info, decoded.data())) {
+        std::fprintf(stderr, "%s does not match the %dx%d scene\n", path.c_str(), res.x, res.y);
+        return 1;
+      }
+      readTexture2D(renderer.sceneTex(), res.x, res.y, uploaded);
+      // Reduced formats keep the scene in half floats; the driver picks the rounding, so allow
+      // one half-float step (2^-10 relative, 2^-24 for subnormals)
+      if (rcStorageFormatInfo(renderer.activeStorageFormat()).scene == GL_RGBA16F) {
+        d = diffRGBA32F(uploaded, decoded, res.x, res.y, 5.9604645e-08f, 4, 9.765625e-04f);
+      } else {
+        d = diffRGBA32F(uploaded, decoded, res.x, res.y, 0.0f);
+      }
+    } else if (opt.primitives > 0) {
+      // The CPU reference only knows the built-in circle; binning must not change the scene
+      std::vector<float> binned, unbinned;
+      readTexture2D(renderer.sceneTex(), res.x, res.y, binned);
+      renderer.setSceneBinning(false);
+      renderer.run_full_rc(opt.probeSize, opt.interval, opt.cascades, res);
+      readTexture2D(renderer.sceneTex(), res.x, res.y, unbinned);
+      renderer.setSceneBinning(true);
+      d = diffRGBA32F(binned, unbinned, res.x, res.y, 0.0f);
+    } else {
+      d = validate_gpu_against_cpu(renderer, opt.probeSize, opt.interval, opt.cascades, res, opt.tolerance);
+    }
+    std::fprintf(report, "validate: %s max_abs=%.6g rmse=%.6g mismatches=%zu worst=(%d,%d)\n",
+                d.passed() ? "PASS" : "FAIL", d.max_abs, d.rmse, d.mismatches, d.worst_x, d.worst_y);
+    if (!d.passed()) status = 1;
+  }
+
+  perf.shutdown();
+  return status;
+}
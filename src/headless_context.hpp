@@ -0,0 +1,132 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Windowless OpenGL 4.3 compatibility context via EGL.
+// - Prefers Mesa's surfaceless platform (works on render nodes and with llvmpipe, no X/Wayland).
+// - Falls back to the default EGL display with a 1x1 pbuffer when surfaceless/no-config
+//   contexts are unavailable.
+// Only compute dispatches and textures are used; there is no default framebuffer.
+class HeadlessGLContext {
+public:
+  HeadlessGLContext() = default;
+  ~HeadlessGLContext() { shutdown(); }
+
+  HeadlessGLContext(const HeadlessGLContext&) = delete;
+  HeadlessGLContext& operator=(const HeadlessGLContext&) = delete;
+
+  bool initialize(int major = 4, int minor = 3) {
+    display_ = openDisplay_();
+    if (display_ == EGL_NO_DISPLAY) {
+      std::cerr << "EGL: no display available.\n";
+      return false;
+    }
+    EGLint vmaj = 0, vmin = 0;
+    if (!eglInitialize(display_, &vmaj, &vmin)) {
+      std::cerr << "EGL: eglInitialize failed (0x" << std::hex << eglGetError() << std::dec << ").\n";
+      display_ = EGL_NO_DISPLAY;
+      return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+      std::cerr << "EGL: desktop OpenGL API not supported.\n";
+      shutdown();
+      return false;
+    }
+
+    const EGLint ctxAttribs[] = {
+      EGL_CONTEXT_MAJOR_VERSION, major,
+      EGL_CONTEXT_MINOR_VERSION, minor,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+      EGL_NONE
+    };
+
+    const std::string exts = queryString_(EGL_EXTENSIONS);
+    const bool noConfig    = exts.find("EGL_KHR_no_config_context") != std::string::npos ||
+                             exts.find("EGL_MESA_configless_context") != std::string::npos;
+    const bool surfaceless = exts.find("EGL_KHR_surfaceless_context") != std::string::npos;
+
+    EGLConfig config = nullptr;
+    if (!(noConfig && surfaceless)) {
+      const EGLint cfgAttribs[] = {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+      };
+      EGLint n = 0;
+      if (!eglChooseConfig(display_, cfgAttribs, &config, 1, &n) || n == 0) {
+        std::cerr << "EGL: no pbuffer-capable OpenGL config.\n";
+        shutdown();
+        return false;
+      }
+      const EGLint pbAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+      surface_ = eglCreatePbufferSurface(display_, config, pbAttribs);
+    }
+
+    context_ = eglCreateContext(display_, config ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, ctxAttribs);
+    if (context_ == EGL_NO_CONTEXT) {
+      std::cerr << "EGL: failed to create OpenGL " << major << "." << minor
+                << " context (0x" << std::hex << eglGetError() << std::dec << ").\n";
+      shutdown();
+      return false;
+    }
+    if (!eglMakeCurrent(display_, surface_, surface_, context_)) {
+      std::cerr << "EGL: eglMakeCurrent failed.\n";
+      shutdown();
+      return false;
+    }
+
+    // GLEW's GLX layer has no display to query here; core/extension entry points still load.
+    GLenum err = glewInit();
+    if (err != GLEW_OK && err != GLEW_ERROR_NO_GLX_DISPLAY) {
+      std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(err) << std::endl;
+      shutdown();
+      return false;
+    }
+    return true;
+  }
+
+  void shutdown() {
+    if (display_ == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_ != EGL_NO_CONTEXT) { eglDestroyContext(display_, context_); context_ = EGL_NO_CONTEXT; }
+    if (surface_ != EGL_NO_SURFACE) { eglDestroySurface(display_, surface_); surface_ = EGL_NO_SURFACE; }
+    eglTerminate(display_);
+    display_ = EGL_NO_DISPLAY;
+  }
+
+  // e.g. "4.5 (Compatibility Profile) Mesa ... | llvmpipe (...)"
+  static std::string describe() {
+    const char* v = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    const char* r = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    return std::string(v ? v : "?") + " | " + (r ? r : "?");
+  }
+
+private:
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+  EGLContext context_ = EGL_NO_CONTEXT;
+
+  static EGLDisplay openDisplay_() {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (getPlatformDisplay && clientExts && std::string(clientExts).find("EGL_MESA_platform_surfaceless") != std::string::npos) {
+      EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+      if (d != EGL_NO_DISPLAY) return d;
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+
+  std::string queryString_(EGLint name) const {
+    const char* s = eglQueryString(display_, name);
+    return s ? std::string(s) : std::string();
+  }
+};
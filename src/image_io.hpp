@@ -0,0 +1,458 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#undef APIENTRY
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Minimal uncompressed image writers for tool output, and scene image readers.
+// Buffers are tightly packed RGBA, row 0 first (GL texture order, i.e. bottom row first).
+
+// Portable Float Map (RGB, little-endian). PFM stores rows bottom-to-top, which matches GL order.
+inline bool writePFM(const std::string& path, int width, int height, const float* rgba) {
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  std::fprintf(f, "PF\n%d %d\n-1.0\n", width, height);
+  std::vector<float> row(size_t(width) * 3u);
+  bool ok = true;
+  for (int y = 0; y < height && ok; ++y) {
+    const float* src = rgba + size_t(y) * size_t(width) * 4u;
+    for (int x = 0; x < width; ++x) {
+      row[size_t(x) * 3 + 0] = src[size_t(x) * 4 + 0];
+      row[size_t(x) * 3 + 1] = src[size_t(x) * 4 + 1];
+      row[size_t(x) * 3 + 2] = src[size_t(x) * 4 + 2];
+    }
+    ok = std::fwrite(row.data(), sizeof(float), row.size(), f) == row.size();
+  }
+  return (std::fclose(f) == 0) && ok;
+}
+
+// Binary PPM (RGB8). PPM stores rows top-to-bottom, so GL rows are written in reverse.
+inline bool writePPM(const std::string& path, int width, int height, const uint8_t* rgba) {
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return false;
+  std::fprintf(f, "P6\n%d %d\n255\n", width, height);
+  std::vector<uint8_t> row(size_t(width) * 3u);
+  bool ok = true;
+  for (int y = height - 1; y >= 0 && ok; --y) {
+    const uint8_t* src = rgba + size_t(y) * size_t(width) * 4u;
+    for (int x = 0; x < width; ++x) {
+      row[size_t(x) * 3 + 0] = src[size_t(x) * 4 + 0];
+      row[size_t(x) * 3 + 1] = src[size_t(x) * 4 + 1];
+      row[size_t(x) * 3 + 2] = src[size_t(x) * 4 + 2];
+    }
+    ok = std::fwrite(row.data(), 1, row.size(), f) == row.size();
+  }
+  return (std::fclose(f) == 0) && ok;
+}
+
+// ----------------------------
+// Scene image readers
+// ----------------------------
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) { close(); return false; }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) { close(); return false; }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    size_ = size_t(size.QuadPart);
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) { close(); return false; }
+    void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) { close(); return false; }
+    madvise(p, size_t(st.st_size), MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t*>(p);
+    size_ = size_t(st.st_size);
+#endif
+    if (!data_) { close(); return false; }
+    return true;
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+// Scene files: raw RGBA32F (tightly packed, GL row order, size must match the scene), PFM
+// (alpha 1 where any channel is non-zero) or 8-bit PNG (sRGB color decoded to linear, alpha
+// is opacity). Recognized by their signatures; anything else is taken as raw.
+enum class SceneImageKind { RawRGBA32F, PFM, PNG };
+
+struct SceneImageInfo {
+  SceneImageKind kind = SceneImageKind::RawRGBA32F;
+  int width = 0, height = 0;
+};
+
+namespace image_io_detail {
+
+inline uint32_t readBE32(const uint8_t* p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+// PFM header: "PF" or "Pf", width, height, scale (negative = little endian), one whitespace.
+inline bool parsePFMHeader(const uint8_t* data, size_t size, int& w, int& h, int& channels,
+                           bool& littleEndian, size_t& offset) {
+  if (size < 3 || data[0] != 'P' || (data[1] != 'F' && data[1] != 'f')) return false;
+  channels = data[1] == 'F' ? 3 : 1;
+  std::string tok[3];
+  size_t i = 2;
+  for (int t = 0; t < 3; ++t) {
+    while (i < size && std::isspace(data[i])) ++i;
+    while (i < size && !std::isspace(data[i]) && tok[t].size() < 32) tok[t] += char(data[i++]);
+  }
+  if (i >= size) return false;
+  offset = i + 1;
+  w = std::atoi(tok[0].c_str());
+  h = std::atoi(tok[1].c_str());
+  littleEndian = std::atof(tok[2].c_str()) < 0.0;
+  return w > 0 && h > 0;
+}
+
+// Canonical Huffman decoding for inflate (RFC 1951), after zlib's puff.
+struct Huffman {
+  uint16_t counts[16];
+  uint16_t symbols[288];
+
+  void build(const uint8_t* lengths, int n) {
+    std::memset(counts, 0, sizeof(counts));
+    for (int s = 0; s < n; ++s) counts[lengths[s]]++;
+    uint16_t offsets[16];
+    offsets[1] = 0;
+    for (int len = 1; len < 15; ++len) offsets[len + 1] = uint16_t(offsets[len] + counts[len]);
+    for (int s = 0; s < n; ++s) if (lengths[s]) symbols[offsets[lengths[s]]++] = uint16_t(s);
+  }
+};
+
+class Inflater {
+public:
+  Inflater(const uint8_t* in, size_t size, std::vector<uint8_t>& out) : in_(in), size_(size), out_(out) {}
+
+  // Raw deflate stream (no zlib header)
+  bool run() {
+    int last = 0;
+    do {
+      last = bits_(1);
+      const int type = bits_(2);
+      bool ok = false;
+      if (type == 0)      ok = stored_();
+      else if (type == 1) ok = fixed_();
+      else if (type == 2) ok = dynamic_();
+      if (!ok || bad_) return false;
+    } while (!last);
+    return true;
+  }
+
+private:
+  const uint8_t* in_;
+  size_t size_, pos_ = 0;
+  uint32_t bitbuf_ = 0;
+  int bitcnt_ = 0;
+  bool bad_ = false;
+  std::vector<uint8_t>& out_;
+
+  int bits_(int need) {
+    uint32_t val = bitbuf_;
+    while (bitcnt_ < need) {
+      if (pos_ >= size_) { bad_ = true; return 0; }
+      val |= uint32_t(in_[pos_++]) << bitcnt_;
+      bitcnt_ += 8;
+    }
+    bitbuf_ = val >> need;
+    bitcnt_ -= need;
+    return int(val & ((1u << need) - 1u));
+  }
+
+  int decode_(const Huffman& h) {
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; ++len) {
+      code |= bits_(1);
+      const int count = h.counts[len];
+      if (code - count < first) return h.symbols[index + (code - first)];
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+      if (bad_) return -1;
+    }
+    return -1;
+  }
+
+  bool stored_() {
+    bitbuf_ = 0;
+    bitcnt_ = 0;
+    if (pos_ + 4 > size_) return false;
+    const unsigned len = in_[pos_] | (unsigned(in_[pos_ + 1]) << 8);
+    const unsigned nlen = in_[pos_ + 2] | (unsigned(in_[pos_ + 3]) << 8);
+    pos_ += 4;
+    if (len != (~nlen & 0xFFFFu) || pos_ + len > size_) return false;
+    out_.insert(out_.end(), in_ + pos_, in_ + pos_ + len);
+    pos_ += len;
+    return true;
+  }
+
+  bool codes_(const Huffman& lencode, const Huffman& distcode) {
+    static const uint16_t lbase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t  lext[29]  = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t dbase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577};
+    static const uint8_t  dext[30]  = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;) {
+      int sym = decode_(lencode);
+      if (sym < 0) return false;
+      if (sym < 256) { out_.push_back(uint8_t(sym)); continue; }
+      if (sym == 256) return true;
+      sym -= 257;
+      if (sym >= 29) return false;
+      const size_t len = size_t(lbase[sym]) + size_t(bits_(lext[sym]));
+      const int dsym = decode_(distcode);
+      if (dsym < 0 || dsym >= 30) return false;
+      const size_t dist = size_t(dbase[dsym]) + size_t(bits_(dext[dsym]));
+      if (bad_ || dist > out_.size()) return false;
+      const size_t from = out_.size() - dist;
+      for (size_t k = 0; k < len; ++k) out_.push_back(out_[from + k]);
+    }
+  }
+
+  bool fixed_() {
+    uint8_t lengths[288];
+    int s = 0;
+    for (; s < 144; ++s) lengths[s] = 8;
+    for (; s < 256; ++s) lengths[s] = 9;
+    for (; s < 280; ++s) lengths[s] = 7;
+    for (; s < 288; ++s) lengths[s] = 8;
+    Huffman lencode, distcode;
+    lencode.build(lengths, 288);
+    for (s = 0; s < 30; ++s) lengths[s] = 5;
+    distcode.build(lengths, 30);
+    return codes_(lencode, distcode);
+  }
+
+  bool dynamic_() {
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    const int nlen = bits_(5) + 257, ndist = bits_(5) + 1, ncode = bits_(4) + 4;
+    if (bad_ || nlen > 286 || ndist > 30) return false;
+    uint8_t lengths[320] = {};
+    for (int k = 0; k < ncode; ++k) lengths[order[k]] = uint8_t(bits_(3));
+    Huffman lencode, distcode;
+    lencode.build(lengths, 19);
+    int index = 0;
+    while (index < nlen + ndist) {
+      int sym = decode_(lencode);
+      if (sym < 0) return false;
+      if (sym < 16) { lengths[index++] = uint8_t(sym); continue; }
+      uint8_t len = 0;
+      int repeat = 0;
+      if (sym == 16) {
+        if (index == 0) return false;
+        len = lengths[index - 1];
+        repeat = 3 + bits_(2);
+      } else if (sym == 17) {
+        repeat = 3 + bits_(3);
+      } else {
+        repeat = 11 + bits_(7);
+      }
+      if (index + repeat > nlen + ndist) return false;
+      while (repeat--) lengths[index++] = len;
+    }
+    if (lengths[256] == 0) return false;
+    lencode.build(lengths, nlen);
+    distcode.build(lengths + nlen, ndist);
+    return codes_(lencode, distcode);
+  }
+};
+
+inline float srgbToLinear(uint8_t v) {
+  const float c = float(v) / 255.0f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline int paeth(int a, int b, int c) {
+  const int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+  return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// 8-bit, non-interlaced gray/gray+alpha/RGB/RGBA PNG into linear RGBA, GL row order.
+inline bool decodePNG(const uint8_t* data, size_t size, int w, int h, int channels, float* dst) {
+  std::vector<uint8_t> zdata;
+  for (size_t pos = 8; pos + 12 <= size;) {
+    const uint32_t len = readBE32(data + pos);
+    if (pos + 12 + len > size) return false;
+    if (std::memcmp(data + pos + 4, "IDAT", 4) == 0) zdata.insert(zdata.end(), data + pos + 8, data + pos + 8 + len);
+    if (std::memcmp(data + pos + 4, "IEND", 4) == 0) break;
+    pos += 12 + len;
+  }
+  if (zdata.size() < 2) return false;
+
+  const size_t stride = size_t(w) * size_t(channels);
+  std::vector<uint8_t> raw;
+  raw.reserve((stride + 1) * size_t(h));
+  Inflater inflater(zdata.data() + 2, zdata.size() - 2, raw);  // skip the zlib header
+  if (!inflater.run() || raw.size() < (stride + 1) * size_t(h)) return false;
+
+  float lut[256];
+  for (int v = 0; v < 256; ++v) lut[v] = srgbToLinear(uint8_t(v));
+  std::vector<uint8_t> prev(stride, 0), cur(stride);
+  for (int y = 0; y < h; ++y) {
+    const uint8_t* line = raw.data() + size_t(y) * (stride + 1);
+    const int filter = line[0];
+    for (size_t x = 0; x < stride; ++x) {
+      const int a = x >= size_t(channels) ? cur[x - size_t(channels)] : 0;
+      const int b = prev[x];
+      const int c = x >= size_t(channels) ? prev[x - size_t(channels)] : 0;
+      int pred = 0;
+      switch (filter) {
+        case 0: pred = 0; break;
+        case 1: pred = a; break;
+        case 2: pred = b; break;
+        case 3: pred = (a + b) >> 1; break;
+        case 4: pred = paeth(a, b, c); break;
+        default: return false;
+      }
+      cur[x] = uint8_t(line[1 + x] + pred);
+    }
+    // PNG rows run top to bottom
+    float* out = dst + size_t(h - 1 - y) * size_t(w) * 4u;
+    for (int x = 0; x < w; ++x) {
+      const uint8_t* px = cur.data() + size_t(x) * size_t(channels);
+      const bool gray = channels <= 2, alpha = channels == 2 || channels == 4;
+      out[4 * x + 0] = lut[px[0]];
+      out[4 * x + 1] = lut[gray ? px[0] : px[1]];
+      out[4 * x + 2] = lut[gray ? px[0] : px[2]];
+      out[4 * x + 3] = alpha ? float(px[channels - 1]) / 255.0f : 1.0f;
+    }
+    std::swap(prev, cur);
+  }
+  return true;
+}
+
+} // namespace image_io_detail
+
+// Identify a scene file and its size; raw files take 'rawWidth' x 'rawHeight' and must match it.
+inline bool inspectSceneImage(const uint8_t* data, size_t size, int rawWidth, int rawHeight, SceneImageInfo& info) {
+  using namespace image_io_detail;
+  static const uint8_t kPNG[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  int channels = 0;
+  bool le = false;
+  size_t offset = 0;
+  if (size >= 33 && std::memcmp(data, kPNG, 8) == 0 && std::memcmp(data + 12, "IHDR", 4) == 0) {
+    info.kind = SceneImageKind::PNG;
+    info.width  = int(readBE32(data + 16));
+    info.height = int(readBE32(data + 20));
+    const int depth = data[24], color = data[25], interlace = data[28];
+    if (depth != 8 || interlace != 0 || !(color == 0 || color == 2 || color == 4 || color == 6)) {
+      std::fprintf(stderr, "unsupported PNG: only 8-bit non-interlaced gray/RGB(A) images\n");
+      return false;
+    }
+    return info.width > 0 && info.height > 0;
+  }
+  if (parsePFMHeader(data, size, info.width, info.height, channels, le, offset)) {
+    info.kind = SceneImageKind::PFM;
+    return offset + size_t(info.width) * size_t(info.height) * size_t(channels) * 4u <= size;
+  }
+  info.kind = SceneImageKind::RawRGBA32F;
+  info.width = rawWidth;
+  info.height = rawHeight;
+  return rawWidth > 0 && rawHeight > 0 && size == size_t(rawWidth) * size_t(rawHeight) * 16u;
+}
+
+// Decode an inspected scene file into 'dst' (width * height linear RGBA floats, GL row order).
+inline bool decodeSceneImage(const uint8_t* data, size_t size, const SceneImageInfo& info, float* dst) {
+  using namespace image_io_detail;
+  const size_t texels = size_t(info.width) * size_t(info.height);
+  if (info.kind == SceneImageKind::RawRGBA32F) {
+    std::memcpy(dst, data, texels * 16u);
+    return true;
+  }
+  if (info.kind == SceneImageKind::PFM) {
+    int w = 0, h = 0, channels = 0;
+    bool le = false;
+    size_t offset = 0;
+    if (!parsePFMHeader(data, size, w, h, channels, le, offset)) return false;
+    const uint16_t probe = 1;
+    const bool swap = le != (*reinterpret_cast<const uint8_t*>(&probe) == 1);
+    const uint8_t* src = data + offset;
+    for (size_t t = 0; t < texels; ++t) {
+      float v[3] = {0.0f, 0.0f, 0.0f};
+      for (int c = 0; c < channels; ++c) {
+        uint8_t b[4];
+        std::memcpy(b, src + (t * size_t(channels) + size_t(c)) * 4u, 4);
+        if (swap) { std::swap(b[0], b[3]); std::swap(b[1], b[2]); }
+        std::memcpy(&v[c], b, 4);
+      }
+      if (channels == 1) v[1] = v[2] = v[0];
+      dst[4 * t + 0] = v[0];
+      dst[4 * t + 1] = v[1];
+      dst[4 * t + 2] = v[2];
+      dst[4 * t + 3] = (v[0] != 0.0f || v[1] != 0.0f || v[2] != 0.0f) ? 1.0f : 0.0f;
+    }
+    return true;
+  }
+  const int color = data[25];
+  const int channels = color == 0 ? 1 : color == 2 ? 3 : color == 4 ? 2 : 4;
+  return decodePNG(data, size, info.width, info.height, channels, dst);
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
@@ -28,8 +29,13 @@
 #include "imgui_impl_opengl3.h"
 #include "implot.h"
 
+#include "program_cache.hpp"
 #include "rc.hpp"
 #include "stats.hpp"
+#include "stats_worker.hpp"
+#include "metrics.hpp"
+#include "reference.hpp"
+#include "frame_pacer.hpp"
 #include "plotting.hpp"
 #include "perf.hpp"
 
@@ -71,6 +77,17 @@ int main() {
       return 1;
     }
 
+    // Shader binaries persist across runs (RC_SHADER_CACHE, empty to disable); misses are
+    // compiled on a hidden window sharing our context, so startup never waits on the compiler
+    const char* shader_cache = std::getenv("RC_SHADER_CACHE");
+    ProgramCache::shared().setDirectory(shader_cache ? shader_cache : "rc_shader_cache");
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* compile_window = glfwCreateWindow(1, 1, "rc shader compiler", nullptr, window);
+    if (compile_window) {
+      ProgramCache::shared().startBackground([compile_window] { glfwMakeContextCurrent(compile_window); return true; },
+                                             [] { glfwMakeContextCurrent(nullptr); });
+    }
+
     // Initialize GPU renderer
     RCGPURenderer g_gpu_renderer;
     g_gpu_renderer.initialize();
@@ -95,19 +112,42 @@ int main() {
     // Dynamic sizing
     int RC_WIDTH = 512, RC_HEIGHT = 512;
 
-    // Stats
-    RadialStats stats;
+    // Stats: bins are read back here and converted on the worker thread
     double last_stats_time = -1.0;
     const double STATS_INTERVAL = 0.25; // seconds between stat updates
     
     // Initialize async stats manager
     static AsyncStatsManager g_stats_manager;
+    static RadialStatsWorker g_stats_worker;
+    g_stats_worker.start();
+
+    // Brute-force reference of the current scene, converged a row band per frame, and the
+    // RC result's error against it (re-measured after every completed sweep)
+    static RCReferenceIntegrator g_reference;
+    static AsyncErrorMetrics g_reference_metrics;
+    RCReferenceSettings reference_settings;
+    reference_settings.rowsPerPass = 32;
+    g_reference.setSettings(reference_settings);
+    // With the background compiler these only queue their programs; the frame loop retries
+    g_reference.initialize();
+    g_reference_metrics.init();
+    ImageErrorMetrics reference_error;
+    uint64_t reference_measured_rays = 0;
+    uint64_t reference_first_generation = 1;  // metrics dispatched before the last reset are stale
 
     // Perf instrumentation
     Perf perf;
     perf.init();
     static uint64_t frame_counter = 0;
 
+    // Continuous mode: RC (and stats) every frame on an animated scene, with at most
+    // max_frames_in_flight frames queued on the GPU. Off: RC only at startup and on resize.
+    bool continuous = false;
+    bool vsync = true;
+    int  max_frames_in_flight = 2;
+    double animation_start = 0.0;
+    FramePacer pacer;
+
     // Window resize debouncing
     static double last_resize_time = 0.0;
     const double RESIZE_DEBOUNCE = 0.1; // 100ms debounce
@@ -116,6 +156,8 @@ int main() {
     auto kick_rc = [&](int w, int h) {
       g_gpu_renderer.run_full_rc(baseProbeSize, baseIntervalLength, NUM_CASCADES,
                                  glm::ivec2(w, h), &perf);
+      // Nothing ran while programs are still compiling; the frame loop kicks again
+      if (g_gpu_renderer.programsPending()) return;
       
       // Initialize and launch async stats computation (no blocking)
       const int max_radius = int(glm::length(glm::vec2(float(w), float(h)) * 0.5f));
@@ -123,6 +165,12 @@ int main() {
       
       GLuint outTex = g_gpu_renderer.resultTex();
       g_stats_manager.dispatch_async(outTex, w, h);
+
+      // New scene/result: start the reference over
+      g_reference.reset();
+      reference_measured_rays = 0;
+      reference_first_generation = g_reference_metrics.dispatched_generation() + 1;
+      reference_error = ImageErrorMetrics{};
     };
 
     // Initial RC run
@@ -142,6 +190,10 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
       glfwPollEvents();
 
+      // Bound the GPU queue before recording anything for this frame
+      pacer.setMaxFramesInFlight(max_frames_in_flight);
+      pacer.beginFrame();
+
       perf.beginFrame(io.DeltaTime);
       frame_counter++;
 
@@ -169,14 +221,38 @@ int main() {
         last_resize_time = 0.0; // Reset debounce
       }
 
+      if (continuous) {
+        g_gpu_renderer.setSceneTime(float(glfwGetTime() - animation_start));
+        kick_rc(RC_WIDTH, RC_HEIGHT);
+      } else if (g_gpu_renderer.programsPending()) {
+        kick_rc(RC_WIDTH, RC_HEIGHT);
+      }
+      const bool rc_ready = !g_gpu_renderer.programsPending();
+
       // Try to read previous frame's stats (non-blocking, async)
       double now = ImGui::GetTime();
       if (last_stats_time < 0.0 || (now - last_stats_time) >= STATS_INTERVAL) {
-        if (g_stats_manager.try_read_stats(stats, RC_WIDTH, RC_HEIGHT)) {
+        if (g_stats_manager.try_read_bins(g_stats_worker.input())) {
+          g_stats_worker.submit();
           last_stats_time = now;
         }
       }
 
+      // One reference slice per frame; measure once a sweep completes (radiance only, the
+      // reference alpha is the mean transmittance)
+      // (nothing to converge to while the scene moves)
+      if (!continuous && rc_ready && g_reference.initialize()) {
+        g_reference.advance(g_gpu_renderer.sceneTex(), glm::ivec2(RC_WIDTH, RC_HEIGHT));
+      }
+      if (g_reference.raysPerPixel() != reference_measured_rays && g_reference_metrics.init()) {
+        reference_measured_rays = g_reference.raysPerPixel();
+        g_reference_metrics.dispatch_async(g_gpu_renderer.resultTex(), g_reference.resultTex(), RC_WIDTH, RC_HEIGHT, 3);
+      }
+      ImageErrorMetrics measured;
+      if (g_reference_metrics.try_read(measured) && measured.generation >= reference_first_generation) {
+        reference_error = measured;
+      }
+
       // Resolve GPU queries from previous frame(s) without blocking
       perf.resolveAll();
 
@@ -307,18 +383,48 @@ int main() {
                        PADDING, PADDING, rc_display_width, rc_display_height,
                        frame_counter, true);
 
+      // Render mode controls, bottom-left of the RC viewport
+      ImGui::SetNextWindowPos(ImVec2(float(PADDING + 8), float(display_h - PADDING - 8)), ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+      ImGui::SetNextWindowBgAlpha(0.6f);
+      if (ImGui::Begin("##RenderMode", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                                                ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoMove)) {
+        if (ImGui::Checkbox("Continuous", &continuous)) {
+          animation_start = glfwGetTime();
+          if (!continuous) {
+            // Back to the static scene
+            g_gpu_renderer.setSceneTime(0.0f);
+            kick_rc(RC_WIDTH, RC_HEIGHT);
+          }
+        }
+        ImGui::SameLine();
+        if (ImGui::Checkbox("VSync", &vsync)) glfwSwapInterval(vsync ? 1 : 0);
+        ImGui::SetNextItemWidth(120.0f);
+        ImGui::SliderInt("Frames in flight", &max_frames_in_flight, 1, FramePacer::kMaxFramesInFlight);
+        ImGui::Text("GPU wait %.2f ms, stalled frames %llu", pacer.lastWaitMs(), (unsigned long long)pacer.stalls());
+        if (!rc_ready) ImGui::TextUnformatted("Compiling shaders...");
+      }
+      ImGui::End();
+
       // Render charts from last computed stats, synchronized with RC hover/markers
-      chartRenderer.render(stats, sync);
+      chartRenderer.render(g_stats_worker.latest(), sync, &reference_error, reference_measured_rays,
+                           g_reference.converged());
 
       ImGui::Render();
       ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
       perf.endFrame();
       glfwSwapBuffers(window);
+      pacer.endFrame();
     }
 
     // Cleanup async stats manager
+    g_stats_worker.stop();
     g_stats_manager.cleanup();
+    g_reference_metrics.cleanup();
+    g_reference.cleanup();
+    pacer.reset();
+    ProgramCache::shared().stopBackground();
+    if (compile_window) glfwDestroyWindow(compile_window);
 
     perf.shutdown();
 
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
+// Full-image error of a result against a reference, from a handful of GPU-reduced sums.
+struct ImageErrorMetrics {
+  double rmse    = 0.0;  // root mean square channel error
+  double max_abs = 0.0;  // largest absolute channel error
+  double rel_l1  = 0.0;  // sum |test - ref| / sum |ref|
+  double psnr    = 0.0;  // dB, peak = largest |ref| channel value; +inf for identical images
+  uint64_t generation = 0;  // AsyncErrorMetrics dispatch this came from
+};
+
+// Two-pass error reduction. Pass 1: each 16x16 tile reduces its texels in shared memory and
+// writes one partial (sum e^2, sum |e|, sum |ref|, max |e|, max |ref|). Pass 2
+// (RC_METRICS_FINAL): one workgroup folds all partials in double precision and writes the
+// five totals. Only the first 'channels' channels are compared.
+static inline const char* kErrorMetricsCS = R"(
+#define GROUP 256
+#ifdef RC_METRICS_FINAL
+layout(local_size_x = GROUP) in;
+#else
+layout(local_size_x = 16, local_size_y = 16) in;
+layout(binding=0) uniform sampler2D testTex;
+layout(binding=1) uniform sampler2D refTex;
+uniform ivec2 imgSize;
+uniform int   channels;
+#endif
+
+// Two vec4s per tile: (sumsq, sumabs, sumref, 0), (maxabs, maxref, 0, 0)
+layout(std430, binding=0) buffer PartialBuf { vec4 partials[]; };
+layout(std430, binding=1) buffer ResultBuf  { double totals[]; };  // sumsq, sumabs, sumref, maxabs, maxref
+
+#ifdef RC_METRICS_FINAL
+uniform int tiles;
+shared double shSum[3 * GROUP];
+shared float  shMax[2 * GROUP];
+
+void main() {
+  uint li = gl_LocalInvocationIndex;
+  double s0 = 0.0LF, s1 = 0.0LF, s2 = 0.0LF;
+  float m0 = 0.0, m1 = 0.0;
+  for (int t = int(li); t < tiles; t += GROUP) {
+    vec4 a = partials[2 * t], b = partials[2 * t + 1];
+    s0 += double(a.x); s1 += double(a.y); s2 += double(a.z);
+    m0 = max(m0, b.x); m1 = max(m1, b.y);
+  }
+  shSum[3u * li] = s0; shSum[3u * li + 1u] = s1; shSum[3u * li + 2u] = s2;
+  shMax[2u * li] = m0; shMax[2u * li + 1u] = m1;
+  barrier();
+  for (uint w = uint(GROUP) / 2u; w > 0u; w >>= 1) {
+    if (li < w) {
+      for (uint k = 0u; k < 3u; ++k) shSum[3u * li + k] += shSum[3u * (li + w) + k];
+      for (uint k = 0u; k < 2u; ++k) shMax[2u * li + k] = max(shMax[2u * li + k], shMax[2u * (li + w) + k]);
+    }
+    barrier();
+  }
+  if (li == 0u) {
+    totals[0] = shSum[0]; totals[1] = shSum[1]; totals[2] = shSum[2];
+    totals[3] = double(shMax[0]); totals[4] = double(shMax[1]);
+  }
+}
+#else
+shared vec3 shSum[GROUP];
+shared vec2 shMax[GROUP];
+
+void main() {
+  uint li = gl_LocalInvocationIndex;
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  vec3 s = vec3(0.0);
+  vec2 m = vec2(0.0);
+  if (p.x < imgSize.x && p.y < imgSize.y) {
+    vec4 a = texelFetch(testTex, p, 0);
+    vec4 b = texelFetch(refTex, p, 0);
+    for (int c = 0; c < channels; ++c) {
+      float e = abs(a[c] - b[c]);
+      // NaN/Inf in the result must not vanish from the maximum
+      if (isnan(e) || isinf(e)) e = 3.0e38;
+      s += vec3(e * e, e, abs(b[c]));
+      m = max(m, vec2(e, abs(b[c])));
+    }
+  }
+  shSum[li] = s;
+  shMax[li] = m;
+  barrier();
+  for (uint w = uint(GROUP) / 2u; w > 0u; w >>= 1) {
+    if (li < w) {
+      shSum[li] += shSum[li + w];
+      shMax[li] = max(shMax[li], shMax[li + w]);
+    }
+    barrier();
+  }
+  if (li == 0u) {
+    uint tile = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    partials[2u * tile]      = vec4(shSum[0], 0.0);
+    partials[2u * tile + 1u] = vec4(shMax[0], 0.0, 0.0);
+  }
+}
+#endif
+)";
+
+// Error metrics of a texture against a reference without reading either image back: each
+// dispatch reduces on the GPU into its own fenced slot of a small ring, and try_read returns
+// the newest finished one through a persistently mapped buffer (five doubles).
+// Both textures are sampled with texelFetch, so any float formats of the same size work.
+class AsyncErrorMetrics {
+public:
+  static constexpr int kRingSize = 3;
+
+  AsyncErrorMetrics() = default;
+  ~AsyncErrorMetrics() { cleanup(); }
+
+  AsyncErrorMetrics(const AsyncErrorMetrics&) = delete;
+  AsyncErrorMetrics& operator=(const AsyncErrorMetrics&) = delete;
+
+  // False while a background compiler (ProgramCache) is still building the shaders: call it
+  // again on a later frame
+  bool init() {
+    if (initialized_) return true;
+    if (failed_) return false;
+    const std::string tiles = std::string("#version 430\n") + kErrorMetricsCS;
+    const std::string reduce = std::string("#version 430\n#define RC_METRICS_FINAL\n") + kErrorMetricsCS;
+    const ProgramStatus status = combineStatus({
+      acquirePipeline(tiles_, tiles, "Error metrics"),
+      acquirePipeline(final_, reduce, "Error metrics")});
+    if (status == ProgramStatus::Pending) return false;
+    failed_ = status == ProgramStatus::Failed;
+    if (failed_) {
+      std::cerr << "Failed to build the error metrics shaders.\n";
+      tiles_.reset();
+      final_.reset();
+      return false;
+    }
+    loc_img_size_ = tiles_.uniform("imgSize");
+    loc_channels_ = tiles_.uniform("channels");
+    loc_tiles_    = final_.uniform("tiles");
+    unit_test_    = GLuint(tiles_.binding("testTex"));
+    unit_ref_     = GLuint(tiles_.binding("refTex"));
+    bind_partial_ = GLuint(tiles_.binding("PartialBuf"));
+    bind_result_  = GLuint(final_.binding("ResultBuf"));
+
+    const bool persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    for (Slot& slot : slots_) {
+      resources_.ensureBuffer(slot.buffer, kResultBytes, persistent ? flags : GL_DYNAMIC_STORAGE_BIT);
+      if (persistent) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        slot.mapped = static_cast<const double*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, kResultBytes, flags));
+      }
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    initialized_ = true;
+    return true;
+  }
+
+  // Launch the reduction of 'test' against 'ref' (both at least W x H). Split storage formats
+  // keep transmittance out of the result alpha: pass channels = 3 for them.
+  void dispatch_async(GLuint test, GLuint ref, int W, int H, int channels = 4) {
+    if (!initialized_ || W <= 0 || H <= 0) return;
+
+    const GLuint gx = GLuint((W + 15) / 16), gy = GLuint((H + 15) / 16);
+    const GLsizeiptr bytes = GLsizeiptr(gx) * GLsizeiptr(gy) * 32;  // two vec4 per tile
+    if (bytes > partial_bytes_) {
+      resources_.ensureBuffer(partials_, bytes);
+      partial_bytes_ = bytes;
+    }
+
+    Slot& slot = slots_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % kRingSize;
+    if (slot.fence) { glDeleteSync(slot.fence); slot.fence = nullptr; }
+
+    glUseProgram(tiles_.program());
+    glUniform2i(loc_img_size_, W, H);
+    glUniform1i(loc_channels_, std::min(std::max(channels, 1), 4));
+    glActiveTexture(GL_TEXTURE0 + unit_test_);
+    glBindTexture(GL_TEXTURE_2D, test);
+    glActiveTexture(GL_TEXTURE0 + unit_ref_);
+    glBindTexture(GL_TEXTURE_2D, ref);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bind_partial_, partials_);
+    glDispatchCompute(gx, gy, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(final_.program());
+    glUniform1i(loc_tiles_, GLint(gx * gy));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bind_result_, slot.buffer);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.generation = ++dispatched_;
+    slot.values = uint64_t(W) * uint64_t(H) * uint64_t(std::min(std::max(channels, 1), 4));
+  }
+
+  // Metrics of the newest finished dispatch not read yet (non-blocking); false if none.
+  // With wait = true it blocks until the newest dispatch finished instead (tools only).
+  bool try_read(ImageErrorMetrics& out, bool wait = false) {
+    if (!initialized_ || consumed_ == dispatched_) return false;
+
+    Slot* ready = nullptr;
+    for (Slot& slot : slots_) {
+      if (!slot.fence || slot.generation <= consumed_) continue;
+      if (ready && slot.generation < ready->generation) continue;
+      if (wait && slot.generation == dispatched_) {
+        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+        ready = &slot;
+        continue;
+      }
+      const GLenum r = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED) ready = &slot;
+    }
+    if (!ready) return false;
+
+    double t[5];
+    if (ready->mapped) {
+      for (int i = 0; i < 5; ++i) t[i] = ready->mapped[i];
+    } else {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, ready->buffer);
+      glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, kResultBytes, t);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    const double n = double(ready->values);
+    const double mse = t[0] / n;
+    const double peak = t[4] > 0.0 ? t[4] : 1.0;
+    out.rmse    = std::sqrt(mse);
+    out.max_abs = t[3];
+    out.rel_l1  = t[2] > 0.0 ? t[1] / t[2] : 0.0;
+    out.psnr    = mse > 0.0 ? 10.0 * std::log10(peak * peak / mse) : std::numeric_limits<double>::infinity();
+    out.generation = ready->generation;
+    consumed_ = ready->generation;
+    return true;
+  }
+
+  // Generation (1, 2, ...) of the result last returned by try_read; 0 before the first
+  uint64_t generation() const { return consumed_; }
+  uint64_t dispatched_generation() const { return dispatched_; }
+
+  void cleanup() {
+    if (!initialized_) return;
+    for (Slot& slot : slots_) {
+      if (slot.fence) glDeleteSync(slot.fence);
+      if (slot.mapped) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+      }
+      resources_.releaseBuffer(slot.buffer);
+      slot = Slot{};
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    resources_.releaseBuffer(partials_);
+    partial_bytes_ = 0;
+    tiles_.reset();
+    final_.reset();
+    next_slot_ = 0;
+    consumed_ = dispatched_;
+    initialized_ = false;
+  }
+
+private:
+  static constexpr GLsizeiptr kResultBytes = 5 * sizeof(double);
+
+  struct Slot {
+    GLuint        buffer = 0;
+    const double* mapped = nullptr;  // null -> glGetBufferSubData
+    GLsync        fence = nullptr;
+    uint64_t      generation = 0;
+    uint64_t      values = 0;        // compared channel values (W * H * channels)
+  };
+
+  Slot slots_[kRingSize];
+  ComputePipeline tiles_, final_;
+  GpuResourceManager resources_;
+  GLuint     partials_ = 0;
+  GLsizeiptr partial_bytes_ = 0;  // grows only, so resizes do not reallocate every dispatch
+  GLint  loc_img_size_ = -1, loc_channels_ = -1, loc_tiles_ = -1;
+  GLuint unit_test_ = 0, unit_ref_ = 1, bind_partial_ = 0, bind_result_ = 1;
+  int next_slot_ = 0;
+  uint64_t dispatched_ = 0;
+  uint64_t consumed_ = 0;
+  bool initialized_ = false;
+  bool failed_ = false;
+};
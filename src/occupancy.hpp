@@ -0,0 +1,128 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
+// "Any texel has alpha > 0" mip pyramid of the scene, for hierarchical empty-space skipping.
+// occupancyTex() is R8 with levels 0..levels()-1; texel q of level k covers scene texels
+// [q << k, (q + 1) << k), and the last texel of a level also covers the remainder of an odd
+// level above it. Built by one reduction pass per level; cheap enough to rebuild every frame.
+class OccupancyPyramid {
+public:
+  static constexpr int kMaxLevels = 8;  // top cells of 128x128 pixels
+
+  OccupancyPyramid() = default;
+  ~OccupancyPyramid() { cleanup(); }
+
+  OccupancyPyramid(const OccupancyPyramid&) = delete;
+  OccupancyPyramid& operator=(const OccupancyPyramid&) = delete;
+
+  // Ready once both programs are built; Pending while the background compiler is still on them
+  // (call again later), Failed if either did not build
+  ProgramStatus initialize() {
+    if (failed_) return ProgramStatus::Failed;
+    const ProgramStatus status = combineStatus({
+      acquirePipeline(seed_, seedCS_(), "Occupancy"),
+      acquirePipeline(reduce_, reduceCS_(), "Occupancy")});
+    if (status == ProgramStatus::Failed) {
+      std::cerr << "Failed to compile occupancy pyramid programs.\n";
+      seed_.reset(); reduce_.reset();
+      failed_ = true;
+    }
+    return status;
+  }
+
+  // Rebuild from the alpha of 'sceneTex' (any float format, sampled). Leaves every level
+  // visible to texel fetches.
+  void build(GLuint sceneTex, const glm::ivec2& res) {
+    if (!seed_ || !reduce_) return;
+    levels_ = 1;
+    while (levels_ < kMaxLevels && (std::max(res.x, res.y) >> levels_) > 0) ++levels_;
+    resources_.ensureTexture2D(occupancy_, res.x, res.y, GL_R8, GL_NEAREST_MIPMAP_NEAREST, GL_NEAREST,
+                               GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, levels_);
+
+    glUseProgram(seed_.program());
+    glActiveTexture(GL_TEXTURE0 + GLuint(seed_.binding("sceneTex")));
+    glBindTexture(GL_TEXTURE_2D, sceneTex);
+    glBindImageTexture(GLuint(seed_.binding("levelOutput")), occupancy_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+    glDispatchCompute(GLuint((res.x + 15) / 16), GLuint((res.y + 15) / 16), 1);
+
+    glUseProgram(reduce_.program());
+    const GLuint unitIn = GLuint(reduce_.binding("levelInput")), unitOut = GLuint(reduce_.binding("levelOutput"));
+    for (int k = 1; k < levels_; ++k) {
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      const int w = std::max(res.x >> k, 1), h = std::max(res.y >> k, 1);
+      glBindImageTexture(unitIn, occupancy_, k - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R8);
+      glBindImageTexture(unitOut, occupancy_, k, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+      glDispatchCompute(GLuint((w + 15) / 16), GLuint((h + 15) / 16), 1);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  }
+
+  GLuint occupancyTex() const { return occupancy_; }
+  int    levels() const { return levels_; }
+
+  void cleanup() {
+    resources_.releaseTexture(occupancy_);
+    seed_.reset(); reduce_.reset();
+  }
+
+private:
+  GpuResourceManager resources_;
+  ComputePipeline seed_, reduce_;
+  GLuint occupancy_ = 0;
+  int    levels_ = 0;
+  bool   failed_ = false;
+
+  static const char* seedCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform sampler2D sceneTex;
+layout(binding = 0, r8) uniform writeonly image2D levelOutput;
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (p.x >= imageSize(levelOutput).x || p.y >= imageSize(levelOutput).y) return;
+  imageStore(levelOutput, p, vec4(texelFetch(sceneTex, p, 0).a > 0.0 ? 1.0 : 0.0));
+}
+)";
+  }
+
+  static const char* reduceCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0, r8) uniform readonly  image2D levelInput;
+layout(binding = 1, r8) uniform writeonly image2D levelOutput;
+
+void main() {
+  ivec2 q = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(levelOutput);
+  if (q.x >= size.x || q.y >= size.y) return;
+
+  // 2x2 children; the last row/column also takes the leftover of an odd finer level
+  ivec2 fine = imageSize(levelInput);
+  ivec2 lo = q * 2;
+  ivec2 hi = ivec2(q.x == size.x - 1 ? fine.x - 1 : lo.x + 1,
+                   q.y == size.y - 1 ? fine.y - 1 : lo.y + 1);
+  float occupied = 0.0;
+  for (int y = lo.y; y <= hi.y; ++y)
+  for (int x = lo.x; x <= hi.x; ++x) {
+    occupied = max(occupied, imageLoad(levelInput, ivec2(x, y)).r);
+  }
+  imageStore(levelOutput, q, vec4(occupied));
+}
+)";
+  }
+};
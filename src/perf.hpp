@@ -9,6 +9,11 @@
 
 #include "imgui.h"
 
+#include "rc_limits.hpp"
+
+// Frames of GPU queries kept in flight before a slot is reused (and dropped if still pending)
+constexpr int kPerfRingDepth = 6;
+
 struct CpuTimer {
   std::chrono::high_resolution_clock::time_point t0;
   inline void start() { t0 = std::chrono::high_resolution_clock::now(); }
@@ -18,10 +23,141 @@ struct CpuTimer {
   }
 };
 
-struct QueryPair {
-  GLuint id[2] = {0, 0};
-  int    write = 0;      // index used for glBeginQuery this frame
-  bool   primed = false;
+// N-deep ring of GL_TIME_ELAPSED queries. Slots are resolved oldest-first once available;
+// a slot still pending when the ring wraps onto it is dropped rather than waited on.
+struct QueryRing {
+  GLuint id[kPerfRingDepth] = {};
+  bool   pending[kPerfRingDepth] = {};
+  int    write = 0;      // slot used for glBeginQuery this frame
+  int    read  = 0;      // oldest slot not yet resolved
+  uint64_t dropped = 0;
+};
+
+// GPU duration of each RC stage for one run_full_rc, from GL_TIMESTAMP markers.
+// cascade_ms is indexed by cascade index (not dispatch order).
+struct GpuStageTimes {
+  double scene_ms    = 0.0;
+  double clear_ms    = 0.0;
+  double cascades_ms = 0.0;  // sum over all cascade passes
+  double blit_ms     = 0.0;
+  double total_ms    = 0.0;
+  double cascade_ms[kRCMaxCascades] = {};
+  int    num_cascades = 0;
+};
+
+// N-frame ring of GL_TIMESTAMP markers bracketing the RC stages.
+// Marker layout per slot: begin, scene end, clear end, one per cascade pass, blit end.
+// Never blocks: slots are read only once their last marker reports GL_QUERY_RESULT_AVAILABLE.
+class GpuTimestampRing {
+public:
+  static constexpr int kMaxMarkers = 4 + kRCMaxCascades;
+
+  inline void init() {
+    for (int s = 0; s < kPerfRingDepth; ++s) glGenQueries(kMaxMarkers, slots_[s].ids);
+  }
+  inline void shutdown() {
+    for (int s = 0; s < kPerfRingDepth; ++s) glDeleteQueries(kMaxMarkers, slots_[s].ids);
+  }
+
+  inline void begin() {
+    Slot& s = slots_[write_];
+    if (s.pending) {
+      // Oldest frame is still in flight; overwrite it instead of stalling.
+      s.pending = false;
+      read_ = (read_ + 1) % kPerfRingDepth;
+      ++dropped_;
+    }
+    s.markers = 0;
+    s.cascades = 0;
+    recording_ = true;
+    mark_();
+  }
+  inline void markSceneEnd() { mark_(); }
+  inline void markClearEnd() { mark_(); }
+  inline void markCascadeEnd(int cascadeIndex) {
+    Slot& s = slots_[write_];
+    if (!recording_ || s.cascades >= kRCMaxCascades) return;
+    s.cascade_index[s.cascades++] = cascadeIndex;
+    mark_();
+  }
+  inline void end() {
+    if (!recording_) return;
+    mark_();
+    slots_[write_].pending = true;
+    recording_ = false;
+    write_ = (write_ + 1) % kPerfRingDepth;
+  }
+
+  // Consumes every completed slot in submission order; returns the number resolved.
+  // 'last' receives the newest completed sample, 'ema' is smoothed across all of them.
+  inline int resolve(GpuStageTimes& last, GpuStageTimes& ema) {
+    int resolved = 0;
+    while (slots_[read_].pending) {
+      Slot& s = slots_[read_];
+      GLuint available = 0;
+      glGetQueryObjectuiv(s.ids[s.markers - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) break;
+
+      GLuint64 ts[kMaxMarkers] = {};
+      for (int m = 0; m < s.markers; ++m) glGetQueryObjectui64v(s.ids[m], GL_QUERY_RESULT, &ts[m]);
+      auto ms = [&](int a, int b) { return double(ts[b] - ts[a]) / 1.0e6; };
+
+      GpuStageTimes t;
+      t.scene_ms = ms(0, 1);
+      t.clear_ms = ms(1, 2);
+      for (int k = 0; k < s.cascades; ++k) {
+        const double c = ms(2 + k, 3 + k);
+        const int ci = s.cascade_index[k];
+        if (ci >= 0 && ci < kRCMaxCascades) t.cascade_ms[ci] = c;
+        if (ci + 1 > t.num_cascades) t.num_cascades = ci + 1;
+        t.cascades_ms += c;
+      }
+      t.blit_ms  = ms(2 + s.cascades, s.markers - 1);
+      t.total_ms = ms(0, s.markers - 1);
+
+      last = t;
+      smooth_(ema, t);
+      s.pending = false;
+      read_ = (read_ + 1) % kPerfRingDepth;
+      ++resolved;
+    }
+    return resolved;
+  }
+
+  uint64_t dropped() const { return dropped_; }
+
+private:
+  struct Slot {
+    GLuint ids[kMaxMarkers] = {};
+    int    cascade_index[kRCMaxCascades] = {};
+    int    markers  = 0;
+    int    cascades = 0;
+    bool   pending  = false;
+  };
+  Slot slots_[kPerfRingDepth];
+  int  write_ = 0;
+  int  read_  = 0;
+  bool recording_ = false;
+  uint64_t dropped_ = 0;
+
+  inline void mark_() {
+    Slot& s = slots_[write_];
+    if (!recording_ || s.markers >= kMaxMarkers) return;
+    glQueryCounter(s.ids[s.markers++], GL_TIMESTAMP);
+  }
+
+  static inline double ema_(double prev, double v) { return prev == 0.0 ? v : (0.8 * prev + 0.2 * v); }
+  static inline void smooth_(GpuStageTimes& e, const GpuStageTimes& t) {
+    e.scene_ms    = ema_(e.scene_ms, t.scene_ms);
+    e.clear_ms    = ema_(e.clear_ms, t.clear_ms);
+    e.cascades_ms = ema_(e.cascades_ms, t.cascades_ms);
+    e.blit_ms     = ema_(e.blit_ms, t.blit_ms);
+    e.total_ms    = ema_(e.total_ms, t.total_ms);
+    for (int i = 0; i < kRCMaxCascades; ++i) {
+      e.cascade_ms[i] = (i < t.num_cascades) ? ema_(e.cascade_ms[i], t.cascade_ms[i]) : 0.0;
+    }
+    e.num_cascades = t.num_cascades;
+  }
 };
 
 class Perf {
@@ -32,36 +168,51 @@ public:
   double cpu_copy_ms  = 0.0;
   double cpu_stats_ms = 0.0;
 
-  // GPU timings (ms) - resolved from previous frame's queries (non-blocking)
+  // CPU submission time of the RC sub-stages (ms), laps inside run_full_rc
+  double cpu_scene_ms    = 0.0;
+  double cpu_cascades_ms = 0.0;
+  double cpu_blit_ms     = 0.0;
+
+  // GPU timings (ms) - resolved from earlier frames' queries (non-blocking)
   double gpu_rc_ms    = 0.0;
   double gpu_copy_ms  = 0.0;
   double gpu_stats_ms = 0.0;
 
+  // Most recent unsmoothed GPU samples (ms), for tools that aggregate their own statistics
+  double gpu_rc_last_ms    = 0.0;
+  double gpu_copy_last_ms  = 0.0;
+  double gpu_stats_last_ms = 0.0;
+
+  // Per-stage / per-cascade GPU breakdown of the RC workload (EMA and newest sample)
+  GpuStageTimes gpu_stages;
+  GpuStageTimes gpu_stages_last;
+
   // FPS (EMA)
   double fps = 0.0;
 
   // Queries
-  QueryPair q_rc;
-  QueryPair q_copy;
-  QueryPair q_stats;
+  GpuTimestampRing ts_rc;
+  QueryRing q_copy;
+  QueryRing q_stats;
 
   // CPU timers
   CpuTimer frame_timer;
   CpuTimer rc_timer;
   CpuTimer copy_timer;
   CpuTimer stats_timer;
+  CpuTimer stage_timer;
 
 public:
   inline void init() {
-    glGenQueries(2, q_rc.id);
-    glGenQueries(2, q_copy.id);
-    glGenQueries(2, q_stats.id);
+    ts_rc.init();
+    glGenQueries(kPerfRingDepth, q_copy.id);
+    glGenQueries(kPerfRingDepth, q_stats.id);
   }
 
   inline void shutdown() {
-    glDeleteQueries(2, q_rc.id);
-    glDeleteQueries(2, q_copy.id);
-    glDeleteQueries(2, q_stats.id);
+    ts_rc.shutdown();
+    glDeleteQueries(kPerfRingDepth, q_copy.id);
+    glDeleteQueries(kPerfRingDepth, q_stats.id);
   }
 
   // FPS smoothing, call once per frame with delta time
@@ -79,19 +230,31 @@ public:
   inline void endCpuCopy()   { cpu_copy_ms = copy_timer.stop_ms(); }
   inline void beginCpuStats(){ stats_timer.start(); }
   inline void endCpuStats()  { cpu_stats_ms= stats_timer.stop_ms(); }
+  inline void beginCpuStage(){ stage_timer.start(); }
+  inline void endCpuStage(double& out_ms) { out_ms = stage_timer.stop_ms(); }
 
   // GPU query helpers (generic + section-specific)
-  static inline void beginGpu(QueryPair& qp) {
-    glBeginQuery(GL_TIME_ELAPSED, qp.id[qp.write]);
+  static inline void beginGpu(QueryRing& qr) {
+    if (qr.pending[qr.write]) {
+      // Oldest query still in flight; reuse it and drop its sample instead of stalling.
+      qr.pending[qr.write] = false;
+      qr.read = (qr.read + 1) % kPerfRingDepth;
+      ++qr.dropped;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, qr.id[qr.write]);
   }
-  static inline void endGpu(QueryPair& qp) {
+  static inline void endGpu(QueryRing& qr) {
     glEndQuery(GL_TIME_ELAPSED);
-    qp.primed = true;
-    qp.write ^= 1; // flip buffer
+    qr.pending[qr.write] = true;
+    qr.write = (qr.write + 1) % kPerfRingDepth;
   }
 
-  inline void beginGpuRC()    { beginGpu(q_rc); }
-  inline void endGpuRC()      { endGpu(q_rc); }
+  // RC workload: timestamp markers around scene, clear, each cascade pass and blit
+  inline void beginGpuRC()                       { ts_rc.begin(); }
+  inline void markGpuSceneEnd()                  { ts_rc.markSceneEnd(); }
+  inline void markGpuClearEnd()                  { ts_rc.markClearEnd(); }
+  inline void markGpuCascadeEnd(int cascadeIdx)  { ts_rc.markCascadeEnd(cascadeIdx); }
+  inline void endGpuRC()                         { ts_rc.end(); }
   inline void beginGpuCopy()  { beginGpu(q_copy); }
   inline void endGpuCopy()    { endGpu(q_copy); }
   inline void beginGpuStats() { beginGpu(q_stats); }
@@ -99,11 +262,22 @@ public:
 
   // Resolve available GPU timings without stalling
   inline void resolveAll() {
-    resolveOne(q_rc,    gpu_rc_ms);
-    resolveOne(q_copy,  gpu_copy_ms);
-    resolveOne(q_stats, gpu_stats_ms);
+    if (ts_rc.resolve(gpu_stages_last, gpu_stages) > 0) {
+      gpu_rc_ms      = gpu_stages.total_ms;
+      gpu_rc_last_ms = gpu_stages_last.total_ms;
+    }
+    resolveOne(q_copy,  gpu_copy_ms,  gpu_copy_last_ms);
+    resolveOne(q_stats, gpu_stats_ms, gpu_stats_last_ms);
   }
 
+  // Per-cascade GPU time (ms, EMA); 0 when not measured
+  inline double gpuCascadeMs(int cascadeIdx) const {
+    return (cascadeIdx >= 0 && cascadeIdx < kRCMaxCascades) ? gpu_stages.cascade_ms[cascadeIdx] : 0.0;
+  }
+
+  // Samples overwritten while still in flight (GPU more than kPerfRingDepth frames behind)
+  inline uint64_t droppedGpuSamples() const { return ts_rc.dropped() + q_copy.dropped + q_stats.dropped; }
+
   // Overlay drawer anchored to the RC viewport (top-left), using ImGui foreground list.
   // Parameters:
   // - display_h: framebuffer height in pixels
@@ -119,15 +293,20 @@ public:
     const float rc_left = (float)rc_x;
     const float rc_top  = (float)display_h - (float)(rc_y + rc_h);
 
-    char lines[256];
-    std::snprintf(lines, sizeof(lines),
+    char lines[1024];
+    int n = std::snprintf(lines, sizeof(lines),
                   "Frame: %llu\nFPS: %.1f\n"
                   "CPU frame: %.2f ms\nCPU rc/copy/stats: %.2f / %.2f / %.2f ms\n"
-                  "GPU rc/copy/stats: %.2f / %.2f / %.2f ms",
+                  "GPU rc/copy/stats: %.2f / %.2f / %.2f ms\n"
+                  "GPU scene/clear/blit: %.3f / %.3f / %.3f ms",
                   (unsigned long long)frame_counter,
                   fps,
                   cpu_frame_ms, cpu_rc_ms, cpu_copy_ms, cpu_stats_ms,
-                  gpu_rc_ms, gpu_copy_ms, gpu_stats_ms);
+                  gpu_rc_ms, gpu_copy_ms, gpu_stats_ms,
+                  gpu_stages.scene_ms, gpu_stages.clear_ms, gpu_stages.blit_ms);
+    for (int i = gpu_stages.num_cascades - 1; i >= 0 && n > 0 && n < (int)sizeof(lines); --i) {
+      n += std::snprintf(lines + n, sizeof(lines) - size_t(n), "\n  cascade %d: %.3f ms", i, gpu_stages.cascade_ms[i]);
+    }
 
     ImVec2 text_pos(rc_left + 8.0f, rc_top + 8.0f);
     ImVec2 text_size = ImGui::CalcTextSize(lines);
@@ -150,15 +329,19 @@ public:
   }
 
 private:
-  static inline void resolveOne(QueryPair& qp, double& out_ms) {
-    if (!qp.primed) return;
-    GLuint prev = qp.id[qp.write ^ 1]; // previous (most recently ended)
-    GLuint available = 0;
-    glGetQueryObjectuiv(prev, GL_QUERY_RESULT_AVAILABLE, &available);
-    if (!available) return;
-    GLuint64 ns = 0;
-    glGetQueryObjectui64v(prev, GL_QUERY_RESULT, &ns);
-    const double ms = double(ns) / 1.0e6;
-    out_ms = (out_ms == 0.0) ? ms : (0.8 * out_ms + 0.2 * ms);
+  static inline void resolveOne(QueryRing& qr, double& out_ms, double& last_ms) {
+    while (qr.pending[qr.read]) {
+      GLuint id = qr.id[qr.read];
+      GLuint available = 0;
+      glGetQueryObjectuiv(id, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available) return;
+      GLuint64 ns = 0;
+      glGetQueryObjectui64v(id, GL_QUERY_RESULT, &ns);
+      qr.pending[qr.read] = false;
+      qr.read = (qr.read + 1) % kPerfRingDepth;
+      const double ms = double(ns) / 1.0e6;
+      last_ms = ms;
+      out_ms = (out_ms == 0.0) ? ms : (0.8 * out_ms + 0.2 * ms);
+    }
   }
 };
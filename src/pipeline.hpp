@@ -0,0 +1,216 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <iostream>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+// Compile and link one compute shader; 0 on failure, with the log on std::cerr prefixed by
+// 'label'. 'retrievable' asks the driver to keep the binary for glGetProgramBinary. The only
+// compile path in the tree: everything else goes through ProgramCache, which calls this.
+inline GLuint compileComputeProgram(const std::string& source, const char* label, bool retrievable = false) {
+  const char* src = source.c_str();
+  GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+  glShaderSource(cs, 1, &src, nullptr);
+  glCompileShader(cs);
+  GLint ok = GL_FALSE;
+  glGetShaderiv(cs, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    char log[4096];
+    glGetShaderInfoLog(cs, 4096, nullptr, log);
+    std::cerr << label << " shader compile error:\n" << log << std::endl;
+    glDeleteShader(cs);
+    return 0;
+  }
+  GLuint prog = glCreateProgram();
+  if (retrievable) glProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(prog, cs);
+  glLinkProgram(prog);
+  glDeleteShader(cs);
+  glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    char log[4096];
+    glGetProgramInfoLog(prog, 4096, nullptr, log);
+    std::cerr << label << " program link error:\n" << log << std::endl;
+    glDeleteProgram(prog);
+    return 0;
+  }
+  return prog;
+}
+
+// Compute program whose interface is reflected once at link time.
+// - uniform(name): default-block uniform location (array uniforms are keyed without "[0]")
+// - binding(name): texture/image unit of samplers and images, or the binding point of
+//   uniform/shader-storage blocks
+// Lookups are meant for setup; cache the returned values for per-pass use.
+class ComputePipeline {
+public:
+  ComputePipeline() = default;
+  ~ComputePipeline() { reset(); }
+
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+  // Takes ownership of a linked program (0 leaves the pipeline empty) and reflects it.
+  bool adopt(GLuint program) {
+    reset();
+    if (program == 0) return false;
+    program_ = program;
+    reflectUniforms_();
+    reflectBlocks_(GL_UNIFORM_BLOCK);
+    reflectBlocks_(GL_SHADER_STORAGE_BLOCK);
+    return true;
+  }
+
+  void reset() {
+    if (program_) glDeleteProgram(program_);
+    program_ = 0;
+    uniforms_.clear();
+    bindings_.clear();
+  }
+
+  GLuint program() const { return program_; }
+  explicit operator bool() const { return program_ != 0; }
+
+  GLint uniform(const std::string& name) const {
+    auto it = uniforms_.find(name);
+    return it == uniforms_.end() ? -1 : it->second;
+  }
+  GLint binding(const std::string& name) const {
+    auto it = bindings_.find(name);
+    return it == bindings_.end() ? -1 : it->second;
+  }
+
+private:
+  GLuint program_ = 0;
+  std::unordered_map<std::string, GLint> uniforms_;
+  std::unordered_map<std::string, GLint> bindings_;
+
+  static std::string baseName_(const char* name) {
+    std::string n(name);
+    if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0) n.resize(n.size() - 3);
+    return n;
+  }
+
+  static bool isOpaque_(GLenum type) {
+    switch (type) {
+      case GL_SAMPLER_2D: case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+      case GL_IMAGE_2D:   case GL_INT_IMAGE_2D:   case GL_UNSIGNED_INT_IMAGE_2D:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void reflectUniforms_() {
+    GLint count = 0;
+    glGetProgramInterfaceiv(program_, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    const GLenum props[3] = {GL_LOCATION, GL_TYPE, GL_BLOCK_INDEX};
+    char name[256];
+    for (GLint i = 0; i < count; ++i) {
+      GLint values[3] = {-1, 0, -1};
+      glGetProgramResourceiv(program_, GL_UNIFORM, GLuint(i), 3, props, 3, nullptr, values);
+      if (values[2] != -1) continue;  // member of a uniform block
+      glGetProgramResourceName(program_, GL_UNIFORM, GLuint(i), sizeof(name), nullptr, name);
+      const std::string key = baseName_(name);
+      uniforms_[key] = values[0];
+      if (isOpaque_(GLenum(values[1])) && values[0] >= 0) {
+        GLint unit = -1;
+        glGetUniformiv(program_, values[0], &unit);
+        bindings_[key] = unit;
+      }
+    }
+  }
+
+  void reflectBlocks_(GLenum iface) {
+    GLint count = 0;
+    glGetProgramInterfaceiv(program_, iface, GL_ACTIVE_RESOURCES, &count);
+    const GLenum prop = GL_BUFFER_BINDING;
+    char name[256];
+    for (GLint i = 0; i < count; ++i) {
+      GLint binding = -1;
+      glGetProgramResourceiv(program_, iface, GLuint(i), 1, &prop, 1, nullptr, &binding);
+      glGetProgramResourceName(program_, iface, GLuint(i), sizeof(name), nullptr, name);
+      bindings_[baseName_(name)] = binding;
+    }
+  }
+};
+
+// Shadow of the binding state touched by compute passes, so redundant binds are skipped.
+// Code outside the owner may change GL state at any time: call invalidate() at the start of
+// each batch of passes (and after handing control to code that does not use the cache).
+class GLStateCache {
+public:
+  static constexpr int kMaxUnits = 16;
+
+  void invalidate() {
+    program_ = kUnknown;
+    for (int i = 0; i < kMaxUnits; ++i) {
+      textures_[i] = kUnknown;
+      images_[i]   = ImageBinding{};
+      ubos_[i]     = kUnknown;
+      ssbos_[i]    = kUnknown;
+    }
+  }
+
+  void useProgram(GLuint program) {
+    if (program_ == program) { ++skipped_; return; }
+    glUseProgram(program);
+    program_ = program;
+  }
+
+  void bindTexture(GLuint unit, GLuint tex) {
+    if (unit < kMaxUnits && textures_[unit] == tex) { ++skipped_; return; }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (unit < kMaxUnits) textures_[unit] = tex;
+  }
+
+  void bindImage(GLuint unit, GLuint tex, GLint level, GLenum access, GLenum format) {
+    const ImageBinding b{tex, level, access, format};
+    if (unit < kMaxUnits && images_[unit] == b) { ++skipped_; return; }
+    glBindImageTexture(unit, tex, level, GL_FALSE, 0, access, format);
+    if (unit < kMaxUnits) images_[unit] = b;
+  }
+
+  void bindUniformBuffer(GLuint binding, GLuint buf) {
+    if (binding < kMaxUnits && ubos_[binding] == buf) { ++skipped_; return; }
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buf);
+    if (binding < kMaxUnits) ubos_[binding] = buf;
+  }
+
+  void bindStorageBuffer(GLuint binding, GLuint buf) {
+    if (binding < kMaxUnits && ssbos_[binding] == buf) { ++skipped_; return; }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buf);
+    if (binding < kMaxUnits) ssbos_[binding] = buf;
+  }
+
+  // Number of binds elided so far (diagnostics)
+  uint64_t skipped() const { return skipped_; }
+
+private:
+  static constexpr GLuint kUnknown = 0xFFFFFFFFu;
+
+  struct ImageBinding {
+    GLuint tex = kUnknown;
+    GLint  level = 0;
+    GLenum access = 0;
+    GLenum format = 0;
+    bool operator==(const ImageBinding& o) const {
+      return tex == o.tex && level == o.level && access == o.access && format == o.format;
+    }
+  };
+
+  GLuint       program_ = kUnknown;
+  GLuint       textures_[kMaxUnits] = {kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown,
+                                       kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown};
+  ImageBinding images_[kMaxUnits];
+  GLuint       ubos_[kMaxUnits]  = {kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown,
+                                    kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown};
+  GLuint       ssbos_[kMaxUnits] = {kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown,
+                                    kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown, kUnknown};
+  uint64_t     skipped_ = 0;
+};
@@ -9,6 +9,7 @@
 #include "implot.h"
 
 #include "stats.hpp"
+#include "metrics.hpp"
 
 // Shared hover state between plots and the RC overlay
 struct HoverSync {
@@ -24,11 +25,126 @@ static inline void PlotVLineCompat(const char* label, float x) {
   ImPlot::PlotLine(label, xs, ys, 2);
 }
 
+// Plot-ready copy of up to kMaxSeries y series that share one ascending x axis, cut to the
+// visible x range and min/max-decimated to two points per pixel column once the range holds
+// more than that. By default each column keeps the minimum and maximum of a series in index
+// order, so peaks survive at any zoom; a Min (Max) series keeps its column minimum (maximum)
+// at both points, so a lower (upper) band edge never cuts into the band. Rebuilt only when the
+// data generation, the visible range, the pixel width or the modes changed; buffers keep their
+// capacity.
+class DecimatedSeries {
+public:
+  static constexpr int kMaxSeries = 4;
+  enum class Mode { MinMax, Min, Max };
+
+  // 'modes' has one entry per series; null means MinMax for all. Returns true if the buffers
+  // were rebuilt.
+  bool update(uint64_t generation, const std::vector<float>& x, const std::vector<float>* const* ys, int series,
+              double xmin, double xmax, int pixels, const Mode* modes = nullptr) {
+    pixels = std::max(pixels, 1);
+    series = std::min(series, kMaxSeries);
+    bool sameModes = true;
+    for (int k = 0; k < series; ++k) sameModes &= modes_[k] == (modes ? modes[k] : Mode::MinMax);
+    if (generation == generation_ && xmin == xmin_ && xmax == xmax_ && pixels == pixels_ && series == series_ &&
+        sameModes) return false;
+    generation_ = generation; xmin_ = xmin; xmax_ = xmax; pixels_ = pixels; series_ = series;
+    for (int k = 0; k < series; ++k) modes_[k] = modes ? modes[k] : Mode::MinMax;
+
+    x_.clear();
+    for (int k = 0; k < series; ++k) y_[k].clear();
+    size_t n = x.size();
+    for (int k = 0; k < series; ++k) n = std::min(n, ys[k]->size());
+    if (n == 0) return true;
+
+    // Visible index range plus one point on either side, so lines reach the plot edges
+    size_t i0 = size_t(std::lower_bound(x.begin(), x.begin() + ptrdiff_t(n), float(xmin)) - x.begin());
+    size_t i1 = size_t(std::upper_bound(x.begin(), x.begin() + ptrdiff_t(n), float(xmax)) - x.begin());
+    i0 = i0 > 0 ? i0 - 1 : 0;
+    i1 = std::min(i1 + 1, n);
+    if (i1 <= i0) return true;
+
+    const size_t count = i1 - i0, buckets = size_t(pixels);
+    if (count <= 2 * buckets) {
+      x_.assign(x.begin() + ptrdiff_t(i0), x.begin() + ptrdiff_t(i1));
+      for (int k = 0; k < series; ++k) y_[k].assign(ys[k]->begin() + ptrdiff_t(i0), ys[k]->begin() + ptrdiff_t(i1));
+      return true;
+    }
+    for (size_t b = 0; b < buckets; ++b) {
+      const size_t lo = i0 + count * b / buckets, hi = i0 + count * (b + 1) / buckets;
+      if (hi <= lo) continue;
+      // Both points of a column sit at its ends; the shift is below one pixel
+      x_.push_back(x[lo]);
+      x_.push_back(x[hi - 1]);
+      for (int k = 0; k < series; ++k) {
+        const float* v = ys[k]->data();
+        size_t mn = lo, mx = lo;
+        for (size_t i = lo + 1; i < hi; ++i) {
+          if (v[i] < v[mn]) mn = i;
+          if (v[i] > v[mx]) mx = i;
+        }
+        switch (modes_[k]) {
+          case Mode::Min: y_[k].push_back(v[mn]); y_[k].push_back(v[mn]); break;
+          case Mode::Max: y_[k].push_back(v[mx]); y_[k].push_back(v[mx]); break;
+          default:
+            y_[k].push_back(v[std::min(mn, mx)]);
+            y_[k].push_back(v[std::max(mn, mx)]);
+        }
+      }
+    }
+    return true;
+  }
+
+  int size() const { return int(x_.size()); }
+  const float* x() const { return x_.data(); }
+  const float* y(int k) const { return y_[k].data(); }
+
+private:
+  std::vector<float> x_, y_[kMaxSeries];
+  Mode modes_[kMaxSeries] = {};
+  uint64_t generation_ = ~uint64_t(0);
+  double xmin_ = 0.0, xmax_ = 0.0;
+  int pixels_ = 0, series_ = 0;
+};
+
 class ImPlotChartRenderer {
 private:
   static inline double shared_x_min = 0.0;
   static inline double shared_x_max = 100.0;
 
+  // Main plot: lower, upper, mean, ground truth; stddev plot: percent
+  enum { kLower, kUpper, kMean, kTruth };
+  DecimatedSeries main_series_, stddev_series_;
+
+  // Summary values, computed once per stats generation
+  struct Summary {
+    uint64_t generation = ~uint64_t(0);
+    size_t size = 0;
+    float max_mean = 0.0f, avg_mean = 0.0f, avg_stddev = 0.0f, max_stddev_pct = 0.0f;
+    float mse_truth = -1.0f;  // < 0: no ground truth of matching size
+  } summary_;
+
+  void update_summary_(const RadialStats& stats) {
+    if (stats.generation == summary_.generation && stats.mean.size() == summary_.size) return;
+    Summary& s = summary_;
+    s = Summary{};
+    s.generation = stats.generation;
+    s.size = stats.mean.size();
+    if (stats.mean.empty()) return;
+    s.max_mean   = *std::max_element(stats.mean.begin(), stats.mean.end());
+    s.avg_mean   = std::accumulate(stats.mean.begin(), stats.mean.end(), 0.0f) / stats.mean.size();
+    s.avg_stddev = std::accumulate(stats.stddev.begin(), stats.stddev.end(), 0.0f) / stats.stddev.size();
+    if (!stats.stddev_percent.empty())
+      s.max_stddev_pct = *std::max_element(stats.stddev_percent.begin(), stats.stddev_percent.end());
+    if (!stats.ground_truth.empty() && stats.mean.size() == stats.ground_truth.size()) {
+      float mse = 0.0f;
+      for (size_t i = 0; i < stats.mean.size(); ++i) {
+        float diff = stats.mean[i] - stats.ground_truth[i];
+        mse += diff * diff;
+      }
+      s.mse_truth = mse / stats.mean.size();
+    }
+  }
+
   static float clamp_radius_from_plot(const RadialStats& stats, double x) {
     if (stats.radii.empty()) return 0.0f;
     double xmin = 0.0, xmax = (double)stats.radii.back();
@@ -43,7 +159,8 @@ private:
     PlotVLineCompat("##hover_x", x);
     ImPlot::PopStyleColor();
 
-    // Tooltip only when this plot is hovered
+    // Tooltip only when this plot is hovered; bins are one pixel of radius each, so the
+    // radius is the index into the full-resolution stats
     if (hovered && !stats.radii.empty()) {
       int r = (int)std::round(x);
       r = std::clamp(r, 0, (int)stats.radii.size() - 1);
@@ -62,12 +179,11 @@ public:
   // - If either plot is hovered, it sets sync.active=true and updates sync.radius.
   // - Regardless of hover source, both plots draw a vertical marker when sync.active is true.
   // - Tooltip behavior remains contextual: shown only when a given plot is hovered.
-  void render(const RadialStats& stats, HoverSync& sync) {
-    std::vector<float> stddev_percent(stats.stddev.size(), 0.0f);
-    for (size_t i = 0; i < stats.stddev.size(); ++i) {
-      if (stats.mean[i] != 0.0f) stddev_percent[i] = (stats.stddev[i] / stats.mean[i]) * 100.0f;
-    }
-
+  // 'reference' (optional) is the result's error against the brute-force reference after
+  // 'referenceRays' rays per pixel.
+  void render(const RadialStats& stats, HoverSync& sync, const ImageErrorMetrics* reference = nullptr,
+              uint64_t referenceRays = 0, bool referenceConverged = false) {
+    update_summary_(stats);
     ImGuiIO& io = ImGui::GetIO();
     ImVec2 display_size = io.DisplaySize;
 
@@ -110,33 +226,32 @@ public:
           ImPlot::SetupAxisLimits(ImAxis_X1, shared_x_min, shared_x_max);
           ImPlot::SetupAxisLimits(ImAxis_Y1, 0, 1.1);
 
-          if (!stats.radii.empty() && !stats.stddev_upper.empty() && !stats.stddev_lower.empty()) {
+          // Series cut to the visible range and decimated to the plot width
+          const bool truth = stats.ground_truth.size() == stats.radii.size();
+          const std::vector<float>* main_ys[] = {&stats.stddev_lower, &stats.stddev_upper, &stats.mean, &stats.ground_truth};
+          // Band edges keep their outermost value per column, so the band only ever widens
+          static constexpr DecimatedSeries::Mode kMainModes[] = {
+            DecimatedSeries::Mode::Min, DecimatedSeries::Mode::Max, DecimatedSeries::Mode::MinMax, DecimatedSeries::Mode::MinMax};
+          const ImPlotRect view = ImPlot::GetPlotLimits();
+          main_series_.update(stats.generation, stats.radii, main_ys, truth ? 4 : 3,
+                              view.X.Min, view.X.Max, int(ImPlot::GetPlotSize().x), kMainModes);
+          const int n = main_series_.size();
+
+          if (n > 0) {
             ImPlot::PushStyleColor(ImPlotCol_Fill, ImVec4(0.2f, 0.6f, 1.0f, 0.5f));
-            ImPlot::PlotShaded("+/-1s Confidence",
-                               stats.radii.data(),
-                               stats.stddev_lower.data(),
-                               stats.stddev_upper.data(),
-                               static_cast<int>(stats.radii.size()));
+            ImPlot::PlotShaded("+/-1s Confidence", main_series_.x(), main_series_.y(kLower), main_series_.y(kUpper), n);
             ImPlot::PopStyleColor();
-          }
 
-          if (!stats.radii.empty() && !stats.mean.empty()) {
             ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(0.2f, 0.6f, 1.0f, 1.0f));
             ImPlot::SetNextLineStyle(ImVec4(0.2f, 0.6f, 1.0f, 1.0f), 2.0f);
-            ImPlot::PlotLine("Mean (mu)",
-                             stats.radii.data(),
-                             stats.mean.data(),
-                             static_cast<int>(stats.radii.size()));
+            ImPlot::PlotLine("Mean (mu)", main_series_.x(), main_series_.y(kMean), n);
             ImPlot::PopStyleColor();
           }
 
-          if (!stats.radii.empty() && !stats.ground_truth.empty()) {
+          if (n > 0 && truth) {
             ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(1.0f, 0.2f, 0.2f, 1.0f));
             ImPlot::SetNextLineStyle(ImVec4(1.0f, 0.2f, 0.2f, 1.0f), 2.0f);
-            ImPlot::PlotLine("Ground Truth",
-                             stats.radii.data(),
-                             stats.ground_truth.data(),
-                             static_cast<int>(stats.radii.size()));
+            ImPlot::PlotLine("Ground Truth", main_series_.x(), main_series_.y(kTruth), n);
             ImPlot::PopStyleColor();
           }
 
@@ -168,20 +283,18 @@ public:
           ImPlot::SetupLegend(ImPlotLocation_NorthEast);
           ImPlot::SetupAxisLimits(ImAxis_X1, shared_x_min, shared_x_max);
 
-          if (!stats.stddev.empty()) {
-            // Precompute percentage if needed
-            std::vector<float> stddev_percent(stats.stddev.size(), 0.0f);
-            for (size_t i = 0; i < stats.stddev.size(); ++i) {
-              if (stats.mean[i] != 0.0f) stddev_percent[i] = (stats.stddev[i] / stats.mean[i]) * 100.0f;
-            }
-            float max_stddev_pct = *std::max_element(stddev_percent.begin(), stddev_percent.end());
-            ImPlot::SetupAxisLimits(ImAxis_Y1, 0, std::max(1.0f, max_stddev_pct * 1.1f));
+          if (!stats.stddev_percent.empty()) {
+            ImPlot::SetupAxisLimits(ImAxis_Y1, 0, std::max(1.0f, summary_.max_stddev_pct * 1.1f));
+
+            // Percentages are precomputed by convert_bins_to_stats
+            const std::vector<float>* pct[] = {&stats.stddev_percent};
+            const ImPlotRect view = ImPlot::GetPlotLimits();
+            stddev_series_.update(stats.generation, stats.radii, pct, 1, view.X.Min, view.X.Max,
+                                  int(ImPlot::GetPlotSize().x));
 
             ImPlot::PushStyleColor(ImPlotCol_Line, ImVec4(1.0f, 0.7f, 0.2f, 1.0f));
             ImPlot::SetNextLineStyle(ImVec4(1.0f, 0.7f, 0.2f, 1.0f), 2.0f);
-            ImPlot::PlotLine("s/mu Ratio",
-                             stats.radii.data(), stddev_percent.data(),
-                             static_cast<int>(stats.radii.size()));
+            ImPlot::PlotLine("s/mu Ratio", stddev_series_.x(), stddev_series_.y(0), stddev_series_.size());
             ImPlot::PopStyleColor();
           }
 
@@ -209,23 +322,22 @@ public:
 
       if (ImGui::CollapsingHeader("Statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
         if (!stats.mean.empty()) {
-          float max_val = *std::max_element(stats.mean.begin(), stats.mean.end());
-          float avg_val = std::accumulate(stats.mean.begin(), stats.mean.end(), 0.0f) / stats.mean.size();
-          float avg_stddev = std::accumulate(stats.stddev.begin(), stats.stddev.end(), 0.0f) / stats.stddev.size();
-
-        ImGui::Text("Peak Luminance (mu_max): %.4f", max_val);
-          ImGui::Text("Average Luminance (mu_avg): %.4f", avg_val);
-          ImGui::Text("Average Std Dev (s_avg): %.4f", avg_stddev);
+          ImGui::Text("Peak Luminance (mu_max): %.4f", summary_.max_mean);
+          ImGui::Text("Average Luminance (mu_avg): %.4f", summary_.avg_mean);
+          ImGui::Text("Average Std Dev (s_avg): %.4f", summary_.avg_stddev);
           ImGui::Text("Data Points: %zu", stats.radii.size());
 
-          if (!stats.ground_truth.empty() && stats.mean.size() == stats.ground_truth.size()) {
-            float mse = 0.0f;
-            for (size_t i = 0; i < stats.mean.size(); ++i) {
-              float diff = stats.mean[i] - stats.ground_truth[i];
-              mse += diff * diff;
-            }
-            mse /= stats.mean.size();
-            ImGui::Text("MSE vs Ground Truth: %.6f", mse);
+          if (summary_.mse_truth >= 0.0f) {
+            ImGui::Text("MSE vs Ground Truth: %.6f", summary_.mse_truth);
+          }
+        }
+        if (reference) {
+          ImGui::Separator();
+          ImGui::Text("Reference: %llu rays/px%s", (unsigned long long)referenceRays,
+                      referenceConverged ? " (converged)" : "");
+          if (reference->generation != 0) {
+            ImGui::Text("RMSE vs Reference: %.6f  (max %.4f)", reference->rmse, reference->max_abs);
+            ImGui::Text("Rel. L1: %.4f  PSNR: %.2f dB", reference->rel_l1, reference->psnr);
           }
         }
       }
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <initializer_list>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "pipeline.hpp"
+
+enum class ProgramStatus { Ready, Pending, Failed };
+
+// Linked compute programs by source, with two ways around the GLSL compiler:
+// - Disk: every program built is saved as a driver binary (glGetProgramBinary) under the
+//   cache directory, keyed on a hash of its source and the driver strings, and later builds
+//   of the same source load it with glProgramBinary. Binaries the driver rejects (e.g. after
+//   an update) are deleted and rebuilt.
+// - Background: with startBackground(), misses are compiled on a context that shares objects
+//   with the main one, on a worker thread. acquire() never blocks; it reports Pending until
+//   the program is built.
+// All compile sites go through shared(). Programs handed out are owned by the caller.
+class ProgramCache {
+public:
+  static ProgramCache& shared() {
+    static ProgramCache cache;
+    return cache;
+  }
+
+  ProgramCache(const ProgramCache&) = delete;
+  ProgramCache& operator=(const ProgramCache&) = delete;
+  ~ProgramCache() { stopBackground(); }
+
+  // Cache binaries under 'dir' (created on demand); empty disables the disk cache. Reads the
+  // driver strings, so call it with the main context current before building anything.
+  void setDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dir_.clear();
+    if (dir.empty()) return;
+    GLint formats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+      std::cerr << "Program binaries unsupported by this driver; shader cache disabled.\n";
+      return;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+      std::cerr << "Cannot create shader cache directory " << dir << ": " << ec.message() << "\n";
+      return;
+    }
+    dir_ = dir;
+    auto str = [](GLenum name) {
+      const char* s = reinterpret_cast<const char*>(glGetString(name));
+      return std::string(s ? s : "");
+    };
+    driver_ = str(GL_VENDOR) + "|" + str(GL_RENDERER) + "|" + str(GL_VERSION) + "|" + str(GL_SHADING_LANGUAGE_VERSION);
+  }
+  const std::string& directory() const { return dir_; }
+
+  // Start the background compiler. 'makeCurrent' runs on the worker thread and must make a
+  // context sharing objects with the main one current there; 'release' runs on it at stop.
+  // Returns false (and stays synchronous) if the context could not be made current.
+  bool startBackground(std::function<bool()> makeCurrent, std::function<void()> release) {
+    if (worker_.joinable()) return true;
+    std::promise<bool> started;
+    std::future<bool> ok = started.get_future();
+    stop_ = false;
+    worker_ = std::thread([this, makeCurrent, release, &started] {
+      const bool current = makeCurrent();
+      started.set_value(current);
+      if (current) run_();
+      if (release) release();
+    });
+    if (!ok.get()) {
+      worker_.join();
+      std::cerr << "Background shader compiler unavailable; compiling on the main thread.\n";
+      return false;
+    }
+    background_ = true;
+    return true;
+  }
+
+  // Finish the build in progress, drop queued ones and free programs nobody acquired
+  void stopBackground() {
+    if (!worker_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+    background_ = false;
+  }
+
+  bool background() const { return background_; }
+
+  // Non-blocking: Ready hands over the program, Failed means it did not compile, Pending that
+  // the background compiler is still on it (ask again later). A disk hit is loaded right here;
+  // without a background compiler a miss is compiled right here.
+  ProgramStatus acquire(const std::string& src, GLuint& program, const char* label = "Compute") {
+    program = 0;
+    if (!background_) {
+      program = build(src, label);
+      return program ? ProgramStatus::Ready : ProgramStatus::Failed;
+    }
+    const uint64_t key = key_(src);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (takeDone_(key, program)) return program ? ProgramStatus::Ready : ProgramStatus::Failed;
+      if (queued_.count(key)) return ProgramStatus::Pending;
+    }
+    program = loadBinary_(key);
+    if (program) return ProgramStatus::Ready;
+    enqueue_(key, src, label);
+    return ProgramStatus::Pending;
+  }
+
+  // Queue a build ahead of its first acquire(); no-op without a background compiler
+  void prefetch(const std::string& src, const char* label = "Compute") {
+    if (background_) enqueue_(key_(src), src, label);
+  }
+
+  // Blocking: the program, or 0 if it failed to build. Takes a background result if there is
+  // one (waiting for it if the worker is already building it).
+  GLuint build(const std::string& src, const char* label = "Compute") {
+    const uint64_t key = key_(src);
+    if (background_) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      GLuint program = 0;
+      done_cv_.wait(lock, [&] { return building_ != key; });
+      if (takeDone_(key, program)) return program;
+      for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+        if (it->key == key) { jobs_.erase(it); break; }
+      }
+      queued_.erase(key);
+    }
+    if (GLuint program = loadBinary_(key)) return program;
+    return compile_(key, src, label);
+  }
+
+private:
+  struct Job {
+    uint64_t    key;
+    std::string src;
+    const char* label;
+  };
+
+  ProgramCache() = default;
+
+  std::mutex mutex_;
+  std::condition_variable cv_, done_cv_;
+  std::thread worker_;
+  std::atomic<bool> background_{false};
+  bool stop_ = false;
+  std::deque<Job> jobs_;
+  std::unordered_set<uint64_t>         queued_;  // queued or building
+  std::unordered_map<uint64_t, GLuint> done_;    // built by the worker, not acquired yet (0 = failed)
+  uint64_t    building_ = 0;
+  std::string dir_, driver_;
+
+  struct BinaryHeader {
+    char     magic[4];
+    uint32_t format;
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t key;
+  };
+
+  // FNV-1a over the driver strings and the source
+  uint64_t key_(const std::string& src) const {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](const std::string& s) {
+      for (unsigned char c : s) { h ^= c; h *= 1099511628211ull; }
+    };
+    mix(driver_);
+    mix(std::string(1, '\0'));
+    mix(src);
+    return h ? h : 1;  // 0 means "nothing" for building_
+  }
+
+  std::string path_(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(dir_) / name).string();
+  }
+
+  bool takeDone_(uint64_t key, GLuint& program) {
+    auto it = done_.find(key);
+    if (it == done_.end()) return false;
+    program = it->second;
+    done_.erase(it);
+    queued_.erase(key);
+    return true;
+  }
+
+  void enqueue_(uint64_t key, const std::string& src, const char* label) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (queued_.count(key) || done_.count(key)) return;
+      queued_.insert(key);
+      jobs_.push_back(Job{key, src, label});
+    }
+    cv_.notify_one();
+  }
+
+  void run_() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+      if (stop_) break;
+      Job job = std::move(jobs_.front());
+      jobs_.pop_front();
+      building_ = job.key;
+      lock.unlock();
+
+      GLuint program = loadBinary_(job.key);
+      if (!program) program = compile_(job.key, job.src, job.label);
+      // The main context may use the program once its creation has completed here
+      glFinish();
+
+      lock.lock();
+      done_[job.key] = program;
+      building_ = 0;
+      done_cv_.notify_all();
+    }
+    for (auto& d : done_) if (d.second) glDeleteProgram(d.second);
+    done_.clear();
+    jobs_.clear();
+    queued_.clear();
+    glFinish();
+  }
+
+  GLuint loadBinary_(uint64_t key) const {
+    if (dir_.empty()) return 0;
+    const std::string path = path_(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return 0;
+    BinaryHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    std::string binary;
+    if (in && std::string(h.magic, 4) == "RCPB" && h.key == key) {
+      binary.resize(h.length);
+      in.read(&binary[0], std::streamsize(h.length));
+    }
+    if (!in || binary.empty()) {
+      in.close();
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+      return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    glProgramBinary(prog, GLenum(h.format), binary.data(), GLsizei(binary.size()));
+    GLint ok = GL_FALSE;
+    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+      // Stale (driver changed) or corrupt: rebuild from source and overwrite it
+      glDeleteProgram(prog);
+      in.close();
+      std::error_code ec;
+      std::filesystem::remove(path, ec);
+      return 0;
+    }
+    return prog;
+  }
+
+  void saveBinary_(uint64_t key, GLuint prog) const {
+    if (dir_.empty()) return;
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::string binary(size_t(length), '\0');
+    GLenum format = 0;
+    glGetProgramBinary(prog, length, &length, &format, &binary[0]);
+    if (length <= 0) return;
+
+    // Write a private file and rename it into place, so concurrent processes never read a
+    // partial binary
+    const BinaryHeader h{{'R', 'C', 'P', 'B'}, uint32_t(format), uint32_t(length), 0u, key};
+    const std::string path = path_(key);
+    const std::string tmp = path + "." + std::to_string(
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) ^
+      uint64_t(std::chrono::steady_clock::now().time_since_epoch().count())) + ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      out.write(binary.data(), std::streamsize(length));
+      if (!out) {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return;
+      }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+  }
+
+  GLuint compile_(uint64_t key, const std::string& source, const char* label) const {
+    const GLuint prog = compileComputeProgram(source, label, !dir_.empty());
+    if (prog) saveBinary_(key, prog);
+    return prog;
+  }
+};
+
+// Acquire 'src' through the shared cache into 'pipeline' (non-blocking): Ready once the pipeline
+// holds it (at once if it already does), Pending while the background compiler is on it, Failed
+// if it did not build. With 'wait' it blocks on the build instead and is never Pending. The one
+// helper the pass owners share instead of each wrapping ProgramCache; owners remember failures,
+// since acquiring a failed source again rebuilds it.
+inline ProgramStatus acquirePipeline(ComputePipeline& pipeline, const std::string& src, const char* label,
+                                     bool wait = false) {
+  if (pipeline) return ProgramStatus::Ready;
+  GLuint program = 0;
+  ProgramStatus status = ProgramStatus::Ready;
+  if (wait) program = ProgramCache::shared().build(src, label);
+  else status = ProgramCache::shared().acquire(src, program, label);
+  if (status == ProgramStatus::Ready && !pipeline.adopt(program)) return ProgramStatus::Failed;
+  return status;
+}
+
+// Status of several acquires taken together: Failed if any failed, else Pending if any is
+inline ProgramStatus combineStatus(std::initializer_list<ProgramStatus> all) {
+  ProgramStatus out = ProgramStatus::Ready;
+  for (ProgramStatus s : all) {
+    if (s == ProgramStatus::Failed) return s;
+    if (s == ProgramStatus::Pending) out = s;
+  }
+  return out;
+}
@@ -5,28 +5,166 @@
 #include <string>
 #include <iostream>
 #include <utility>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "rc_limits.hpp"
 #include "texture.hpp"
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
 #include "scene.hpp"
+#include "scene_import.hpp"
+#include "sdf.hpp"
+#include "occupancy.hpp"
 #include "perf.hpp"
 
 // GPU-only Radiance Cascade renderer.
 // - Inputs sampled via sampler2D (texelFetch); outputs written via imageStore (RGBA32F).
 // - Intermediates remain linear; final sRGB OETF is applied only in the blit-to-display compute.
+// - Per-cascade parameters live in one std140 UBO uploaded when the configuration changes;
+//   a pass only sets its cascade index and the bindings that differ from the previous pass.
+// - Every cascade keeps its own texture (cascade i reads i+1, the one above the top stays zero),
+//   so run_dirty_rc can recompute only the probes a changed scene region can reach.
+
+// Staggered temporal refresh for run_full_rc. Cascade i (i >= fullRateCascades) is refreshed
+// over a period of 2^min(i - fullRateCascades + 1, maxPeriodLog2) frames, one horizontal band
+// per frame, so each cascade's per-frame cost is its full cost divided by its period and the
+// frame time stays flat. Bands that are not refreshed keep their previous result.
+struct RCTemporalSettings {
+  bool enabled          = false;
+  int  fullRateCascades = 1;  // cascades [0, fullRateCascades) update every frame
+  int  maxPeriodLog2    = 3;  // longest period is 2^maxPeriodLog2 frames
+};
+
+// Empty-space skipping for the interval march. Both modes only skip samples that read empty
+// (alpha 0) texels and keep the uniform march's sample positions.
+// - DistanceField: sphere-trace a jump-flood distance field of the occluders
+// - Occupancy: walk an "any occupied" mip pyramid, jumping over empty cells
+enum class RCSpaceSkipping { None, DistanceField, Occupancy };
+
+inline const char* rcSpaceSkippingName(RCSpaceSkipping mode) {
+  switch (mode) {
+    case RCSpaceSkipping::DistanceField: return "sdf";
+    case RCSpaceSkipping::Occupancy:     return "occupancy";
+    default:                             return "none";
+  }
+}
+
+// How each interval is traversed.
+// - Reference: 32 << i uniform steps for cascade i, whatever the interval length
+// - PerPixel: ceil(stepsPerPixel * interval length) uniform steps
+// - GridDDA: exact Amanatides-Woo walk of the interval (clipped to the screen), one sample per
+//   crossed texel; empty-space skipping does not apply
+enum class RCStepPolicy { Reference, PerPixel, GridDDA };
+
+struct RCStepSchedule {
+  RCStepPolicy policy = RCStepPolicy::Reference;
+  float stepsPerPixel = 2.0f;  // PerPixel only
+  bool operator==(const RCStepSchedule& o) const { return policy == o.policy && stepsPerPixel == o.stepsPerPixel; }
+};
+
+inline std::string rcStepScheduleName(const RCStepSchedule& s) {
+  switch (s.policy) {
+    case RCStepPolicy::PerPixel: {
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), "per-pixel:%g", s.stepsPerPixel);
+      return buf;
+    }
+    case RCStepPolicy::GridDDA: return "dda";
+    default:                    return "reference";
+  }
+}
+
+// "reference", "dda", "per-pixel" or "per-pixel:N"
+inline bool parseRCStepSchedule(const std::string& name, RCStepSchedule& out) {
+  RCStepSchedule s;
+  if (name == "reference") {
+    s.policy = RCStepPolicy::Reference;
+  } else if (name == "dda") {
+    s.policy = RCStepPolicy::GridDDA;
+  } else if (name.compare(0, 9, "per-pixel") == 0) {
+    s.policy = RCStepPolicy::PerPixel;
+    if (name.size() > 9) {
+      if (name[9] != ':') return false;
+      s.stepsPerPixel = float(std::atof(name.c_str() + 10));
+      if (!(s.stepsPerPixel > 0.0f)) return false;
+    }
+  } else {
+    return false;
+  }
+  out = s;
+  return true;
+}
+
+// March iterations per cascade, from the step counters (each fetches at most one scene texel)
+struct RCStepCounts {
+  int      cascades = 0;
+  uint64_t steps[kRCMaxCascades]  = {};
+  uint64_t texels[kRCMaxCascades] = {};  // cascade texels dispatched
+};
+
+// Cascade storage formats. Reduced formats trade precision for merge bandwidth (the 16-fetch
+// merge loop is bandwidth-bound); split formats keep transmittance in its own R8/R16 texture
+// because the RGB-only packed formats have no alpha.
+enum class RCStorageFormat {
+  RGBA32F,         // 16 B/texel, reference
+  RGBA16F,         //  8 B/texel
+  R11G11B10F_R8,   //  4 + 1 B/texel
+  R11G11B10F_R16,  //  4 + 2 B/texel
+  RGB9E5_R16,      //  4 + 2 B/texel; written through an R32UI view with manual packing
+  Count
+};
+
+struct RCStorageFormatInfo {
+  const char* name;
+  GLenum scene;          // scene texture format (image-writable)
+  GLenum radiance;       // cascade texture format (RGB, plus transmittance when not split)
+  GLenum transmittance;  // 0 when transmittance lives in radiance alpha
+  bool   packRGB9E5;     // radiance stored via an R32UI view
+};
+
+inline const RCStorageFormatInfo& rcStorageFormatInfo(RCStorageFormat f) {
+  static const RCStorageFormatInfo kInfo[int(RCStorageFormat::Count)] = {
+    {"rgba32f",        GL_RGBA32F, GL_RGBA32F,        0,       false},
+    {"rgba16f",        GL_RGBA16F, GL_RGBA16F,        0,       false},
+    {"r11g11b10f_r8",  GL_RGBA16F, GL_R11F_G11F_B10F, GL_R8,   false},
+    {"r11g11b10f_r16", GL_RGBA16F, GL_R11F_G11F_B10F, GL_R16,  false},
+    {"rgb9e5_r16",     GL_RGBA16F, GL_RGB9_E5,        GL_R16,  true},
+  };
+  return kInfo[int(f)];
+}
+
+inline bool parseRCStorageFormat(const std::string& name, RCStorageFormat& out) {
+  for (int i = 0; i < int(RCStorageFormat::Count); ++i) {
+    if (name == rcStorageFormatInfo(RCStorageFormat(i)).name) { out = RCStorageFormat(i); return true; }
+  }
+  return false;
+}
+
+// Pixel-space rectangle (same origin as the scene texture)
+struct RCRect {
+  int x = 0, y = 0, w = 0, h = 0;
+  bool empty() const { return w <= 0 || h <= 0; }
+};
+
 class RCGPURenderer {
 public:
   RCGPURenderer()
-  : rc_program_(0)
-  , blit_program_(0)
+  : params_ubo_(0)
   , scene_texture_(0)
-  , cascade_input_(0)
-  , cascade_output_(0)
   , display_texture_(0)
   , width_(0)
   , height_(0)
+  , history_valid_(false)
+  , last_coverage_(0.0f)
   , gpu_available_(false) {}
 
   ~RCGPURenderer() {
@@ -40,177 +178,821 @@ public:
       gpu_available_ = false;
       return false;
     }
-    // Compile RC compute shader now; blit program is compiled on first use
-    rc_program_ = compileCompute_(rcCS_());
-    if (rc_program_ == 0) {
-      std::cerr << "Failed to compile RC compute program.\n";
+    // Build and reflect every program the default settings need (reference RC variant, blit,
+    // scene, clears) up front so passes never look anything up by name and the first run
+    // compiles nothing; other formats and variants are built on first use. With a background
+    // compiler (ProgramCache) this only queues them, and runs are skipped until they are built.
+    blit_failed_ = false;
+    requestOptions_();
+    requestPrograms_(RCStorageFormat::RGBA32F, preaverage_);
+    if (rc_programs_[int(RCStorageFormat::RGBA32F)][0].failed || blit_failed_) {
+      std::cerr << "Failed to compile RC compute programs.\n";
       gpu_available_ = false;
       return false;
     }
+    params_key_ = ParamsKey{};
+    history_valid_ = false;
     gpu_available_ = true;
     return true;
   }
 
   // Orchestrates scene generation and all cascade passes; then blits to an internal RGBA8 texture.
-  // If 'perf' is provided, brackets the entire RC workload (scene + cascades + blit) with RC timers.
+  // If 'perf' is provided, brackets the entire RC workload (scene + cascades + blit) with RC timers
+  // and places GPU timestamps between scene, clear, each cascade pass and the blit.
   void run_full_rc(int baseProbeSize,
                    float baseIntervalLength,
                    int numCascades,
                    const glm::ivec2& resolution,
                    Perf* perf = nullptr) {
-    if (!gpu_available_) return;
-
-    ensureTextures_(resolution.x, resolution.y);
+    run_rc_(baseProbeSize, baseIntervalLength, numCascades, resolution, /*generateScene*/true, nullptr, perf);
+  }
 
-    if (perf) { perf->beginCpuRC(); perf->beginGpuRC(); }
+  // Incremental update: the caller changed sceneTex() inside 'dirty' since the last run.
+  // Only probes whose intervals (or whose upper-cascade merge footprint) can reach those rects
+  // are recomputed; every other texel of every cascade is kept. Falls back to recomputing all
+  // cascades (without regenerating the scene) when the configuration changed.
+  void run_dirty_rc(int baseProbeSize,
+                    float baseIntervalLength,
+                    int numCascades,
+                    const glm::ivec2& resolution,
+                    const std::vector<RCRect>& dirty,
+                    Perf* perf = nullptr) {
+    run_rc_(baseProbeSize, baseIntervalLength, numCascades, resolution, /*generateScene*/false, &dirty, perf);
+  }
 
-    // Generate analytical scene into scene_texture_ (RGBA32F, linear)
-    scene_.generate(scene_texture_, resolution, /*circleRadius*/15.0f, /*circleColor*/glm::vec4(1,1,1,1));
+  // Takes effect on the next run_full_rc. Configuration changes always recompute everything;
+  // run_dirty_rc ignores these settings and stays exact.
+  void setTemporalRefresh(const RCTemporalSettings& settings) { temporal_ = settings; }
+  const RCTemporalSettings& temporalRefresh() const { return temporal_; }
 
-    // Prepare initial N+1 texture (cascade_input_) to zero; barrier so subsequent sampling is coherent
-    clearTexture2D(cascade_input_, width_, height_);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+  // Refresh period in frames of cascade i under the current temporal settings
+  int refreshPeriod(int cascadeIndex) const {
+    if (!temporal_.enabled || cascadeIndex < temporal_.fullRateCascades) return 1;
+    const int k = std::min(cascadeIndex - temporal_.fullRateCascades + 1, std::max(temporal_.maxPeriodLog2, 0));
+    return 1 << k;
+  }
 
-    // Run cascades from top (N = numCascades-1) down to 0
-    for (int i = numCascades - 1; i >= 0; --i) {
-      run_cascade_pass(baseProbeSize, baseIntervalLength, i, resolution);
+  // Storage format for scene and cascades; takes effect on the next run (reallocates and
+  // recomputes). Formats the context cannot provide fall back to RGBA16F.
+  void setStorageFormat(RCStorageFormat format) { format_ = format; }
+  RCStorageFormat storageFormat() const { return format_; }
+  // Format the textures of the last run actually use (the requested one unless it fell back)
+  RCStorageFormat activeStorageFormat() const { return active_format_; }
+
+  // Merge from a pre-averaged copy of each cascade (the mean of every 4 child directions),
+  // cutting merge fetches from 16 to 4 per texel at the cost of one small extra pass per
+  // cascade. Takes effect on the next run (recomputes); off if unsupported.
+  void setPreaveragedMerge(bool enabled) { preaverage_ = enabled; }
+  bool preaveragedMerge() const { return preaverage_; }
+
+  // March up to 'maxCascades' low cascades from a per-workgroup copy of the scene in shared
+  // memory (footprint plus that cascade's apron) instead of texel fetches; cascades whose apron
+  // does not fit use the global path. Results are identical either way. Off (0) by default:
+  // on llvmpipe every tiled cascade measured slower than the global path, so only raise it
+  // where rc_bench's per-cascade times show a win.
+  void setSharedSceneTiles(int maxCascades) { shared_tile_limit_ = std::max(maxCascades, 0); }
+  int  sharedSceneTiles() const { return shared_tile_limit_; }
+
+  // Number of low cascades that marched from shared memory in the last run
+  int sharedTileCascades() const { return shared_tile_cascades_; }
+
+  // Interval traversal policy; takes effect on the next run (recomputes everything).
+  void setStepSchedule(const RCStepSchedule& schedule) { schedule_ = schedule; }
+  const RCStepSchedule& stepSchedule() const { return schedule_; }
+
+  // Count march iterations per cascade in every run (a shared-memory sum and one 64-bit
+  // global add per workgroup). Off by default.
+  void setStepCounters(bool enabled) { step_counters_ = enabled; }
+  bool stepCounters() const { return step_counters_; }
+
+  // Counts of the last run with counters on; blocks until the GPU has finished it.
+  bool readStepCounts(RCStepCounts& out) const {
+    if (!active_step_counters_ || step_counter_buf_ == 0) return false;
+    uint32_t raw[2 * kRCMaxCascades] = {};
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, step_counter_buf_);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(raw), raw);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    out = RCStepCounts{};
+    out.cascades = last_cascades_;
+    for (int i = 0; i < last_cascades_; ++i) {
+      out.steps[i]  = uint64_t(raw[2 * i]) | (uint64_t(raw[2 * i + 1]) << 32);
+      out.texels[i] = last_texels_[i];
     }
-
-    // Single barrier after all cascades complete
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-
-    // Postprocess blit from final RGBA32F (linear) into RGBA8 (sRGB) for display
-    ensureTexture2D(display_texture_, width_, height_, GL_RGBA8, GL_LINEAR, GL_LINEAR);
-    run_blit_to_display(resolution);
-
-    // Barrier so callers can immediately sample display_texture_
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
-
-    if (perf) { perf->endGpuRC(); perf->endCpuRC(); }
+    return true;
   }
 
-  // Final linear RGBA32F after last pass (ping-pong leaves newest in cascade_input_)
-  GLuint resultTex() const { return cascade_input_; }
+  // Acceleration structure built after the scene each run and used by every interval march.
+  // None by default; falls back to None if unsupported.
+  void setSpaceSkipping(RCSpaceSkipping mode) { skipping_ = mode; }
+  RCSpaceSkipping spaceSkipping() const { return skipping_; }
+
+  // Primitive list drawn by the next scene generation instead of the built-in circle (empty
+  // restores it). Copied immediately; see GPUScene::setPrimitives.
+  void setScenePrimitives(const ScenePrimitive* prims, size_t count) { scene_.setPrimitives(prims, count); }
+  void setSceneBinning(bool enabled) { scene_.setBinning(enabled); }
+  // Animation time of the generated scene for the next run_full_rc; see GPUScene::setTime
+  void setSceneTime(float seconds) { scene_.setTime(seconds); }
+
+  // Scene from an image file (raw RGBA32F of 'resolution', PFM or 8-bit PNG) instead of the
+  // generated one, until clearSceneImage(). The file is decoded now and uploaded by the next
+  // run_full_rc whose resolution matches it; loading the next frame of a sequence right after
+  // a run overlaps the decode with that run's GPU work. See SceneImageImporter.
+  bool loadSceneImage(const std::string& path, const glm::ivec2& resolution) { return importer_.load(path, resolution); }
+  void clearSceneImage() { importer_.clear(); }
+
+  // Final linear radiance (cascade 0) in the storage format; alpha is transmittance only for
+  // the RGBA formats
+  GLuint resultTex() const { return cascade_tex_.empty() ? 0 : cascade_tex_[0]; }
 
   // Display-friendly RGBA8 texture after blit
   GLuint displayTex() const { return display_texture_; }
 
+  // Linear scene: RGBA32F with the rgba32f storage format, RGBA16F with every reduced one (see
+  // activeStorageFormat). Callers may draw into it and report the change via run_dirty_rc
+  GLuint sceneTex() const { return scene_texture_; }
+
   bool gpuAvailable() const { return gpu_available_; }
 
+  // True when the last run was skipped because the background compiler had not built all of
+  // its programs yet; the previous results are unchanged. Run again on a later frame.
+  bool programsPending() const { return programs_pending_; }
+
+  // Program/texture/buffer binds elided by the state cache so far (diagnostics)
+  uint64_t skippedBinds() const { return state_.skipped(); }
+
+  // Fraction of cascade texels dispatched by the last run (1 for a full recompute)
+  float lastUpdateCoverage() const { return last_coverage_; }
+
 private:
   // ----------------------------
   // GL objects and state
   // ----------------------------
-  GLuint rc_program_;
-  GLuint blit_program_;
+  // Cascade or pre-average program variant, with its interface reflected at link time
+  struct RCProgram {
+    ComputePipeline pipeline;
+    bool   failed = false;
+    GLint  loc_cascade_index = -1;
+    GLint  loc_region_origin = -1;
+    GLint  loc_tile_apron = -1;
+    GLuint unit_scene = 0;
+    GLuint unit_input = 1;
+    GLuint unit_trans_input = 3;
+    GLuint unit_output = 2;
+    GLuint unit_trans_output = 3;
+    GLuint unit_preaveraged = 4;  // sampler in the cascade pass, image in the pre-average pass
+    GLuint unit_distance = 5;
+    GLuint unit_occupancy = 6;
+    GLuint ssbo_step_counters = 0;
+    GLuint ubo_binding = 0;
+  };
+  enum RCVariant { kVariantPreaveraged = 1, kVariantSharedTile = 2, kVariantDistanceField = 4,
+                   kVariantOccupancy = 8, kVariantGridDDA = 16, kVariantStepCounters = 32, kVariantCount = 64 };
+  RCProgram       rc_programs_[int(RCStorageFormat::Count)][kVariantCount];  // [format][RCVariant bits]
+  RCProgram       preaverage_programs_[int(RCStorageFormat::Count)];
+  RCStorageFormat format_ = RCStorageFormat::RGBA32F;         // requested
+  RCStorageFormat active_format_ = RCStorageFormat::RGBA32F;  // in use by the textures
+  bool            preaverage_ = false;                        // requested
+  bool            active_preaverage_ = false;                 // pre-averaged textures are maintained
+  int             shared_tile_limit_ = 0;                     // requested max tiled cascades
+  int             active_shared_tile_limit_ = 0;              // after fallbacks
+  int             shared_tile_cascades_ = 0;                  // cascades [0, n) use the tile variant
+  RCSpaceSkipping skipping_ = RCSpaceSkipping::None;          // requested
+  RCSpaceSkipping active_skipping_ = RCSpaceSkipping::None;
+  RCStepSchedule  schedule_;                                  // requested
+  RCStepSchedule  active_schedule_;
+  bool            step_counters_ = false;                     // requested
+  bool            active_step_counters_ = false;
+  std::string     fallbacks_;                                 // fallback messages last reported
+  GLuint          step_counter_buf_ = 0;                      // {lo, hi} uint pairs per cascade
+  uint64_t        last_texels_[kRCMaxCascades] = {};
+  int             last_cascades_ = 0;
+  ComputePipeline blit_pipeline_;
+  bool            blit_failed_ = false;
+  bool            programs_pending_ = false;                  // a needed program is still being built
+  GLStateCache    state_;
   GPUScene scene_;
+  SceneImageImporter importer_;
+  SceneDistanceField sdf_;
+  OccupancyPyramid   occupancy_;
+  GpuResourceManager resources_;
+
+  // Reflected when the blit program is adopted
+  GLint  blit_loc_resolution_ = -1;
+  GLuint blit_unit_src_ = 0;
+  GLuint blit_unit_dst_ = 1;
+
+  // std140 mirror of CascadeBlock in rcCS_
+  struct CascadeParamsStd140 {
+    int32_t geometry[4];  // probeSize, bilinearProbeSize, steps, unused
+    float   interval[4];  // range start, range end, unused, unused
+  };
+  struct CascadeBlockStd140 {
+    CascadeParamsStd140 cascades[kRCMaxCascades];
+    float resolution[2];
+    float pad_[2];
+  };
+
+  // Configuration the UBO was last uploaded for
+  struct ParamsKey {
+    int   baseProbeSize = -1;
+    float baseIntervalLength = -1.0f;
+    int   numCascades = -1;
+    int   width = -1, height = -1;
+    RCStepSchedule schedule;
+    bool operator==(const ParamsKey& o) const {
+      return baseProbeSize == o.baseProbeSize && baseIntervalLength == o.baseIntervalLength &&
+             numCascades == o.numCascades && width == o.width && height == o.height && schedule == o.schedule;
+    }
+  };
+  ParamsKey params_key_;
+  GLuint    params_ubo_;
+  CascadeBlockStd140 params_{};  // CPU copy, used for dirty-region growth
 
   GLuint scene_texture_;
-  GLuint cascade_input_;
-  GLuint cascade_output_;
+  std::vector<GLuint> cascade_tex_;  // [0, numCascades) results, [numCascades] stays zero
+  std::vector<GLuint> trans_tex_;    // split formats: transmittance, indexed like cascade_tex_
+  std::vector<GLuint> view_tex_;     // RGB9E5: R32UI views of cascade_tex_ for imageStore
+  std::vector<GLuint> preavg_tex_;   // pre-averaged merge: child-direction means of cascade j
   GLuint display_texture_;
 
-  int  width_;
-  int  height_;
-  bool gpu_available_;
+  std::vector<RCRect> regions_[kRCMaxCascades];  // per-cascade dispatch rects of the current run
+
+  RCTemporalSettings temporal_;
+  uint64_t temporal_frame_ = 0;  // advances once per temporal run_full_rc
+
+  int   width_;
+  int   height_;
+  bool  history_valid_;  // cascade_tex_ holds a complete result for params_key_
+  float last_coverage_;
+  bool  gpu_available_;
+  bool  unavailable_logged_ = false;  // runs without a GPU report it once
 
   // ----------------------------
   // Helpers
   // ----------------------------
   void cleanup() {
-    if (rc_program_)     { glDeleteProgram(rc_program_);     rc_program_ = 0; }
-    if (blit_program_)   { glDeleteProgram(blit_program_);   blit_program_ = 0; }
-    if (scene_texture_)  { glDeleteTextures(1, &scene_texture_);  scene_texture_ = 0; }
-    if (cascade_input_)  { glDeleteTextures(1, &cascade_input_);  cascade_input_ = 0; }
-    if (cascade_output_) { glDeleteTextures(1, &cascade_output_); cascade_output_ = 0; }
-    if (display_texture_){ glDeleteTextures(1, &display_texture_);display_texture_ = 0; }
-  }
-
-  static GLuint compileCompute_(const char* src) {
-    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(cs, 1, &src, nullptr);
-    glCompileShader(cs);
-    GLint ok = GL_FALSE;
-    glGetShaderiv(cs, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-      char log[4096];
-      glGetShaderInfoLog(cs, 4096, nullptr, log);
-      std::cerr << "Compute shader compile error:\n" << log << std::endl;
-      glDeleteShader(cs);
-      return 0;
-    }
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, cs);
-    glLinkProgram(prog);
-    glDeleteShader(cs);
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-      char log[4096];
-      glGetProgramInfoLog(prog, 4096, nullptr, log);
-      std::cerr << "Compute program link error:\n" << log << std::endl;
-      glDeleteProgram(prog);
-      return 0;
-    }
-    return prog;
-  }
-
-  void ensureTextures_(int w, int h) {
-    if (width_ == w && height_ == h &&
-        scene_texture_ != 0 && cascade_input_ != 0 && cascade_output_ != 0)
+    for (auto& variants : rc_programs_) for (RCProgram& p : variants) { p.pipeline.reset(); p.failed = false; }
+    for (RCProgram& p : preaverage_programs_) { p.pipeline.reset(); p.failed = false; }
+    blit_pipeline_.reset();
+    sdf_.cleanup();
+    importer_.cleanup();
+    resources_.releaseBuffer(step_counter_buf_);
+    occupancy_.cleanup();
+    resources_.releaseBuffer(params_ubo_);
+    resources_.releaseTexture(scene_texture_);
+    for (GLuint& t : view_tex_)    resources_.releaseTexture(t);
+    for (GLuint& t : cascade_tex_) resources_.releaseTexture(t);
+    for (GLuint& t : trans_tex_)   resources_.releaseTexture(t);
+    for (GLuint& t : preavg_tex_)  resources_.releaseTexture(t);
+    preavg_tex_.clear();
+    view_tex_.clear();
+    cascade_tex_.clear();
+    trans_tex_.clear();
+    resources_.releaseTexture(display_texture_);
+    history_valid_ = false;
+  }
+
+  void run_rc_(int baseProbeSize,
+               float baseIntervalLength,
+               int numCascades,
+               const glm::ivec2& resolution,
+               bool generateScene,
+               const std::vector<RCRect>* dirty,
+               Perf* perf) {
+    if (!gpu_available_) {
+      if (!unavailable_logged_) std::cerr << "RCGPURenderer: not initialized or no compute support; run skipped.\n";
+      unavailable_logged_ = true;
       return;
+    }
+    // Nothing to compute (and no top cascade texture to index) without cascades or pixels
+    if (numCascades < 1 || resolution.x < 1 || resolution.y < 1) return;
+    if (numCascades > kRCMaxCascades) numCascades = kRCMaxCascades;
+
+    if (!resolveFormat_()) return;
+    const RCStorageFormatInfo& fi = rcStorageFormatInfo(active_format_);
+    // Parameters first: pre-averaged texture sizes follow the probe sizes
+    const bool configChanged  = uploadCascadeParams_(baseProbeSize, baseIntervalLength, numCascades, resolution);
+    const bool sceneAllocated = ensureTextures_(resolution.x, resolution.y, numCascades);
+    if (sceneAllocated || configChanged) history_valid_ = false;
+
+    if (perf) { perf->beginCpuRC(); perf->beginGpuRC(); }
+
+    // Generate analytical scene (or upload the imported image) into scene_texture_ (linear);
+    // a freshly allocated scene is always filled, since its contents are undefined
+    if (perf) perf->beginCpuStage();
+    const bool imported = importer_.loaded() && importer_.size() == resolution;
+    if (imported) {
+      // Dirty runs keep the current image; a new one replaces the whole scene
+      if ((generateScene && importer_.pending()) || sceneAllocated) importer_.upload(scene_texture_);
+    } else if (generateScene || sceneAllocated) {
+      scene_.generate(scene_texture_, resolution, /*circleRadius*/15.0f, /*circleColor*/glm::vec4(1,1,1,1), fi.scene);
+    }
+    // Every run may see a new scene (run_dirty_rc callers paint into it); counted as scene time
+    if (activeSkipping_() == RCSpaceSkipping::DistanceField) sdf_.build(scene_texture_, resolution);
+    if (activeSkipping_() == RCSpaceSkipping::Occupancy)     occupancy_.build(scene_texture_, resolution);
+    if (perf) { perf->endCpuStage(perf->cpu_scene_ms); perf->markGpuSceneEnd(); }
+
+    // The texture above the top cascade must read as zero; it only needs clearing when the
+    // configuration (and so which texture plays that role) changed
+    if (perf) perf->beginCpuStage();
+    if (!history_valid_) {
+      resources_.clearTexture2D(cascade_tex_[size_t(numCascades)]);
+      if (fi.transmittance) resources_.clearTexture2D(trans_tex_[size_t(numCascades)]);
+      if (active_preaverage_) resources_.clearTexture2D(preavg_tex_[size_t(numCascades)]);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+    if (perf) perf->markGpuClearEnd();
+
+    // Scene generation, clears and other owners may have changed bindings since the last frame
+    state_.invalidate();
+
+    if (!history_valid_) {
+      for (int i = 0; i < numCascades; ++i) regions_[i].assign(1, RCRect{0, 0, resolution.x, resolution.y});
+    } else if (dirty) {
+      computeDirtyRegions_(*dirty, numCascades);
+    } else {
+      computeTemporalRegions_(numCascades);
+    }
+
+    shared_tile_cascades_ = sharedTileCascadeCount_(numCascades);
+    if (active_step_counters_) {
+      resources_.ensureBuffer(step_counter_buf_, GLsizeiptr(2 * kRCMaxCascades * sizeof(uint32_t)));
+      resources_.clearBuffer(step_counter_buf_);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    last_cascades_ = numCascades;
+
+    // Run cascades from top (N = numCascades-1) down to 0; each pass samples the one above,
+    // so its writes must be visible to texel fetches before the next pass
+    long long texels = 0;
+    for (int i = numCascades - 1; i >= 0; --i) {
+      last_texels_[i] = 0;
+      for (const RCRect& r : regions_[i]) {
+        run_cascade_pass(i, r);
+        last_texels_[i] += uint64_t(r.w) * uint64_t(r.h);
+      }
+      texels += (long long)last_texels_[i];
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+      if (active_preaverage_ && i > 0) {
+        for (const RCRect& r : regions_[i]) run_preaverage_pass(i, r);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+      }
+      if (perf) perf->markGpuCascadeEnd(i);
+    }
+    last_coverage_ = float(double(texels) / (double(resolution.x) * resolution.y * numCascades));
+    history_valid_ = true;
+
+    // Single barrier after all cascades complete
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    if (perf) perf->endCpuStage(perf->cpu_cascades_ms);
+
+    // Postprocess blit from final RGBA32F (linear) into RGBA8 (sRGB) for display
+    if (perf) perf->beginCpuStage();
+    run_blit_to_display(resolution);
+
+    // Barrier so callers can immediately sample display_texture_
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    if (perf) perf->endCpuStage(perf->cpu_blit_ms);
+
+    if (perf) { perf->endGpuRC(); perf->endCpuRC(); }
+  }
+
+  // Pick the settings for this run: the requested ones where their programs (and, for RGB9E5,
+  // texture views) are available. Otherwise the format falls back to RGBA16F and the other
+  // options are dropped, in the active_* copies only, so the requests survive. Failed programs
+  // stay failed, so resolving again costs nothing after the first run. Returns false (skip
+  // the run) while a program the run needs is still being built in the background.
+  bool resolveFormat_() {
+    std::string fallbacks;
+    RCStorageFormat f = format_;
+    bool preaverage = preaverage_;
+    if (rcStorageFormatInfo(f).packRGB9E5 && !(GLEW_VERSION_4_3 || GLEW_ARB_texture_view)) {
+      fallbacks += "RGB9E5 cascade storage needs texture views; using rgba16f.\n";
+      f = RCStorageFormat::RGBA16F;
+    }
+    requestOptions_();
+    if (!requestPrograms_(f, preaverage)) return false;
+    if (!ensureRCProgram_(f, 0)) {
+      fallbacks += std::string("RC program for ") + rcStorageFormatInfo(f).name + " unavailable; using rgba16f.\n";
+      f = RCStorageFormat::RGBA16F;
+      if (!requestPrograms_(f, preaverage)) return false;
+    }
+    if (preaverage && !(ensureRCProgram_(f, kVariantPreaveraged) && ensurePreaverageProgram_(f))) {
+      fallbacks += "Pre-averaged merge unavailable; using the 16-fetch merge.\n";
+      preaverage = false;
+    }
+
+    if (activeSkipping_() != RCSpaceSkipping::None) {
+      const ProgramStatus status = ensureSpaceSkipping_();
+      if (status == ProgramStatus::Pending) { programs_pending_ = true; return false; }
+      if (status == ProgramStatus::Failed) {
+        fallbacks += "Empty-space skipping unavailable; using uniform steps.\n";
+        active_skipping_ = RCSpaceSkipping::None;
+      }
+    }
+    // Fallbacks above may have changed the variant
+    if (!ensureRCProgram_(f, variant_(false, preaverage))) {
+      if (programs_pending_) return false;
+      fallbacks += "RC march variant unavailable; using the reference march without counters.\n";
+      active_skipping_      = RCSpaceSkipping::None;
+      active_schedule_      = RCStepSchedule{};
+      active_step_counters_ = false;
+    }
+    if (active_shared_tile_limit_ > 0 && !ensureRCProgram_(f, variant_(true, preaverage))) {
+      if (programs_pending_) return false;
+      fallbacks += "Shared-memory scene tiles unavailable; marching from the scene texture.\n";
+      active_shared_tile_limit_ = 0;
+    }
+    // Pre-averaged textures are only maintained while the mode is on: turning it on needs a
+    // full recompute to fill them
+    if (preaverage != active_preaverage_ || f != active_format_) history_valid_ = false;
+    active_format_ = f;
+    active_preaverage_ = preaverage;
+
+    // Report fallbacks when they change, not on every run
+    if (fallbacks != fallbacks_) std::cerr << fallbacks;
+    fallbacks_ = fallbacks;
+    return true;
+  }
+
+  // Start the active options from the requested ones; resolveFormat_ drops what is unavailable
+  void requestOptions_() {
+    active_skipping_          = skipping_;
+    active_schedule_          = schedule_;
+    active_step_counters_     = step_counters_;
+    active_shared_tile_limit_ = shared_tile_limit_;
+  }
 
+  // Ask for every program a run in format 'f' needs at once (scene, space skipping and clear
+  // fallbacks included), so a background compiler queues them together. False while any is
+  // pending; failures are left to resolveFormat_ and the owners.
+  bool requestPrograms_(RCStorageFormat f, bool preaverage) {
+    programs_pending_ = false;
+    ensureBlitProgram_();
+    ensureRCProgram_(f, 0);
+    if (preaverage) {
+      ensureRCProgram_(f, kVariantPreaveraged);
+      ensurePreaverageProgram_(f);
+    }
+    ensureRCProgram_(f, variant_(false, preaverage));
+    if (active_shared_tile_limit_ > 0) ensureRCProgram_(f, variant_(true, preaverage));
+
+    const RCStorageFormatInfo& fi = rcStorageFormatInfo(f);
+    auto pending = [this](ProgramStatus status) { if (status == ProgramStatus::Pending) programs_pending_ = true; };
+    pending(scene_.requestPrograms(fi.scene));
+    if (activeSkipping_() != RCSpaceSkipping::None) pending(ensureSpaceSkipping_());
+    pending(resources_.requestClearProgram(fi.radiance));
+    if (fi.transmittance) pending(resources_.requestClearProgram(fi.transmittance));
+    if (preaverage) pending(resources_.requestClearProgram(preaveragedFormat_(f)));
+    return !programs_pending_;
+  }
+
+  // Returns true if the scene texture was (re)allocated.
+  bool ensureTextures_(int w, int h, int numCascades) {
     width_ = w; height_ = h;
+    const RCStorageFormatInfo& fi = rcStorageFormatInfo(active_format_);
+
+    // Linear-space scene and cascades; one texture per cascade plus the zero top
+    const bool sceneAllocated =
+      resources_.ensureTexture2D(scene_texture_, w, h, fi.scene, GL_NEAREST, GL_NEAREST);
+    const size_t count = size_t(numCascades) + 1;
+    bool cascadesAllocated = ensureTextureSet_(cascade_tex_, count, w, h, fi.radiance);
+    cascadesAllocated |= ensureTextureSet_(trans_tex_, fi.transmittance ? count : 0, w, h, fi.transmittance);
+    if (cascadesAllocated) history_valid_ = false;
+
+    // RGB9E5 is not image-storable: write through R32UI views of the same storage
+    const size_t views = fi.packRGB9E5 ? count : 0;
+    for (size_t i = views; i < view_tex_.size(); ++i) resources_.releaseTexture(view_tex_[i]);
+    view_tex_.resize(views, 0);
+    for (size_t i = 0; i < views; ++i) resources_.ensureTextureView(view_tex_[i], cascade_tex_[i], GL_R32UI);
+
+    // Pre-averaged cascades j = 1..numCascades (index 0 unused): probe grid of j times the
+    // direction tile of j-1
+    const size_t averaged = active_preaverage_ ? count : 0;
+    for (size_t i = averaged; i < preavg_tex_.size(); ++i) resources_.releaseTexture(preavg_tex_[i]);
+    preavg_tex_.resize(averaged, 0);
+    for (size_t j = 1; j < averaged; ++j) {
+      const glm::ivec2 size = preaveragedSize_(int(j));
+      if (resources_.ensureTexture2D(preavg_tex_[j], size.x, size.y, preaveragedFormat_(), GL_NEAREST, GL_NEAREST)) {
+        history_valid_ = false;
+      }
+    }
 
-    // Linear-space RGBA32F for scene and cascades
-    ensureTexture2D(scene_texture_,   w, h, GL_RGBA32F, GL_NEAREST, GL_NEAREST);
-    ensureTexture2D(cascade_input_,   w, h, GL_RGBA32F, GL_NEAREST, GL_NEAREST);  // ping
-    ensureTexture2D(cascade_output_,  w, h, GL_RGBA32F, GL_NEAREST, GL_NEAREST);  // pong
+    // sRGB-encoded RGBA8 for display
+    resources_.ensureTexture2D(display_texture_, w, h, GL_RGBA8, GL_LINEAR, GL_LINEAR);
+    return sceneAllocated;
+  }
 
-    // display_texture_ is ensured on blit
+  // Resize 'set' to 'count' textures of one format; returns true if any was (re)allocated.
+  bool ensureTextureSet_(std::vector<GLuint>& set, size_t count, int w, int h, GLenum format) {
+    for (size_t i = count; i < set.size(); ++i) resources_.releaseTexture(set[i]);
+    set.resize(count, 0);
+    bool allocated = false;
+    for (GLuint& t : set) allocated |= resources_.ensureTexture2D(t, w, h, format, GL_NEAREST, GL_NEAREST);
+    return allocated;
   }
 
-  void run_cascade_pass(int baseProbeSize, float baseIntervalLength, int cascadeIndex, const glm::ivec2& res) {
-    glUseProgram(rc_program_);
+  // Half-resolution texel grid of the pre-averaged cascade j (j may be numCascades, which has
+  // no UBO entry)
+  glm::ivec2 preaveragedSize_(int j) const {
+    const int ps = params_key_.baseProbeSize << j;
+    return glm::ivec2((width_ + ps - 1) / ps * (ps / 2), (height_ + ps - 1) / ps * (ps / 2));
+  }
 
-    // Uniforms
-    glUniform1i(glGetUniformLocation(rc_program_, "cascadeIndex"), cascadeIndex);
-    glUniform1i(glGetUniformLocation(rc_program_, "baseProbeSize"), baseProbeSize);
-    glUniform1f(glGetUniformLocation(rc_program_, "baseIntervalLength"), baseIntervalLength);
-    glUniform2f(glGetUniformLocation(rc_program_, "resolution"), float(res.x), float(res.y));
+  // Pre-averaged data is small; keep it at full precision for the reference format only
+  static GLenum preaveragedFormat_(RCStorageFormat f) {
+    return f == RCStorageFormat::RGBA32F ? GL_RGBA32F : GL_RGBA16F;
+  }
+  GLenum preaveragedFormat_() const { return preaveragedFormat_(active_format_); }
+
+  // Adopt the program built from 'src'. False while the background compiler is still on it
+  // (sets programs_pending_) or, setting 'failed', if it did not build.
+  bool adoptProgram_(ComputePipeline& pipeline, const std::string& src, bool& failed) {
+    switch (acquirePipeline(pipeline, src, "Radiance cascades")) {
+      case ProgramStatus::Ready:   return true;
+      case ProgramStatus::Pending: programs_pending_ = true; return false;
+      case ProgramStatus::Failed:  break;
+    }
+    failed = true;
+    return false;
+  }
 
-    // Sampler bindings
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, scene_texture_);
-    glUniform1i(glGetUniformLocation(rc_program_, "sceneTex"), 0);
+  // Build and reflect a program variant once; false if it failed to build or is pending.
+  bool ensureProgram_(RCProgram& p, const std::string& src) {
+    if (p.pipeline) return true;
+    if (p.failed || !adoptProgram_(p.pipeline, src, p.failed)) return false;
+    auto unit = [&](const char* name, GLuint& out) {
+      const GLint b = p.pipeline.binding(name);
+      if (b >= 0) out = GLuint(b);
+    };
+    p.loc_cascade_index = p.pipeline.uniform("cascadeIndex");
+    p.loc_region_origin = p.pipeline.uniform("regionOrigin");
+    p.loc_tile_apron    = p.pipeline.uniform("tileApron");
+    unit("sceneTex", p.unit_scene);
+    unit("cascadeInputTex", p.unit_input);
+    unit("transmittanceInputTex", p.unit_trans_input);
+    unit("cascadeOutput", p.unit_output);
+    unit("transmittanceOutput", p.unit_trans_output);
+    unit("preaveragedInputTex", p.unit_preaveraged);
+    unit("preaveragedOutput", p.unit_preaveraged);
+    unit("distanceTex", p.unit_distance);
+    unit("occupancyTex", p.unit_occupancy);
+    unit("StepCounters", p.ssbo_step_counters);
+    unit("CascadeBlock", p.ubo_binding);
+    return true;
+  }
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, cascade_input_);
-    glUniform1i(glGetUniformLocation(rc_program_, "cascadeInputTex"), 1);
+  bool ensureBlitProgram_() {
+    if (blit_pipeline_) return true;
+    if (blit_failed_ || !adoptProgram_(blit_pipeline_, blitCS_(), blit_failed_)) return false;
+    blit_loc_resolution_  = blit_pipeline_.uniform("resolution");
+    blit_unit_src_        = GLuint(blit_pipeline_.binding("src"));
+    blit_unit_dst_        = GLuint(blit_pipeline_.binding("dst"));
+    params_key_ = ParamsKey{};  // its resolution is set with the cascade parameters
+    return true;
+  }
 
-    // Output image (writeonly)
-    glBindImageTexture(2, cascade_output_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+  bool ensureRCProgram_(RCStorageFormat format, int variant) {
+    return ensureProgram_(rc_programs_[int(format)][variant], rcCS_(rcStorageFormatInfo(format), variant));
+  }
 
-    // Dispatch (workgroup size chosen independent of ray step schedule)
-    GLuint gx = (GLuint)((res.x + 15) / 16);
-    GLuint gy = (GLuint)((res.y + 15) / 16);
+  // The grid DDA visits every crossed texel once; it has nothing to skip
+  RCSpaceSkipping activeSkipping_() const {
+    return active_schedule_.policy == RCStepPolicy::GridDDA ? RCSpaceSkipping::None : active_skipping_;
+  }
+
+  ProgramStatus ensureSpaceSkipping_() {
+    return activeSkipping_() == RCSpaceSkipping::DistanceField ? sdf_.initialize() : occupancy_.initialize();
+  }
+
+  // Cascade program variant for the active settings
+  int variant_(bool sharedTile) const { return variant_(sharedTile, active_preaverage_); }
+  int variant_(bool sharedTile, bool preaverage) const {
+    int v = preaverage ? kVariantPreaveraged : 0;
+    if (sharedTile) v |= kVariantSharedTile;
+    if (activeSkipping_() == RCSpaceSkipping::DistanceField) v |= kVariantDistanceField;
+    if (activeSkipping_() == RCSpaceSkipping::Occupancy)     v |= kVariantOccupancy;
+    if (active_schedule_.policy == RCStepPolicy::GridDDA)    v |= kVariantGridDDA;
+    if (active_step_counters_)                               v |= kVariantStepCounters;
+    return v;
+  }
+
+  // Edge of the shared scene tile: a 16x16 workgroup plus the apron on each side, within the
+  // 32 KiB every GL 4.3 implementation provides. Half-float scenes are kept packed, which
+  // doubles the texels per byte without changing any value.
+  static int sharedTileSize_(const RCStorageFormatInfo& fi) { return fi.scene == GL_RGBA32F ? 44 : 60; }
+
+  // Apron cascade i needs: samples lie within the interval end of a probe center, which is
+  // within a probe size of the workgroup, plus one for truncation
+  int tileApron_(int cascadeIndex) const {
+    const CascadeParamsStd140& c = params_.cascades[cascadeIndex];
+    return c.geometry[0] + int(std::ceil(c.interval[1])) + 1;
+  }
+
+  // Cascades [0, n) that march from the tile: up to the requested limit, while the apron fits
+  int sharedTileCascadeCount_(int numCascades) const {
+    const int maxApron = (sharedTileSize_(rcStorageFormatInfo(active_format_)) - 16) / 2;
+    const int limit = std::min(numCascades, active_shared_tile_limit_);
+    int n = 0;
+    while (n < limit && tileApron_(n) <= maxApron) ++n;
+    return n;
+  }
+
+  bool ensurePreaverageProgram_(RCStorageFormat format) {
+    const char* out = gpuFormatInfo(format == RCStorageFormat::RGBA32F ? GL_RGBA32F : GL_RGBA16F).imageQualifier;
+    return ensureProgram_(preaverage_programs_[int(format)], preaverageCS_(rcStorageFormatInfo(format), out));
+  }
+
+  // Fill the per-cascade UBO; a no-op unless the configuration changed (returns true if it did).
+  // Interval ranges are computed in float exactly as the shader used to (one rounding each).
+  bool uploadCascadeParams_(int baseProbeSize, float baseIntervalLength, int numCascades, const glm::ivec2& res) {
+    const ParamsKey key{baseProbeSize, baseIntervalLength, numCascades, res.x, res.y, active_schedule_};
+    if (params_ubo_ != 0 && key == params_key_) return false;
+    params_key_ = key;
+
+    CascadeBlockStd140& block = params_;
+    block = CascadeBlockStd140{};
+    for (int i = 0; i < numCascades; ++i) {
+      CascadeParamsStd140& c = block.cascades[i];
+      c.geometry[0] = baseProbeSize << i;
+      c.geometry[1] = baseProbeSize << (i + 1);
+      const float scaleCurrent = (i <= 0) ? 0.0f : float(1 << (2 * i));
+      const float scaleNext    = float(1 << (2 * (i + 1)));
+      c.interval[0] = baseIntervalLength * scaleCurrent;
+      c.interval[1] = baseIntervalLength * scaleNext;
+      c.geometry[2] = 32 << i;  // reference step schedule; the grid DDA derives its own count
+      if (active_schedule_.policy == RCStepPolicy::PerPixel) {
+        const double steps = std::ceil(double(c.interval[1] - c.interval[0]) * active_schedule_.stepsPerPixel);
+        c.geometry[2] = int32_t(std::min(std::max(steps, 1.0), double(1 << 24)));
+      }
+    }
+    block.resolution[0] = float(res.x);
+    block.resolution[1] = float(res.y);
+
+    resources_.ensureBuffer(params_ubo_, GLsizeiptr(sizeof(block)));
+    glBindBuffer(GL_UNIFORM_BUFFER, params_ubo_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, GLsizeiptr(sizeof(block)), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Blit resolution is program state; set it once per configuration too
+    glProgramUniform2f(blit_pipeline_.program(), blit_loc_resolution_, float(res.x), float(res.y));
+    return true;
+  }
+
+  // ----------------------------
+  // Dirty-region propagation
+  // ----------------------------
+  static RCRect grow_(const RCRect& r, int m) { return RCRect{r.x - m, r.y - m, r.w + 2 * m, r.h + 2 * m}; }
+
+  static RCRect unite_(const RCRect& a, const RCRect& b) {
+    const int x0 = std::min(a.x, b.x), y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.w, b.x + b.w), y1 = std::max(a.y + a.h, b.y + b.h);
+    return RCRect{x0, y0, x1 - x0, y1 - y0};
+  }
+
+  static bool touches_(const RCRect& a, const RCRect& b) {
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+  }
+
+  // Expand to whole probes of size 'a' and clip to the screen
+  RCRect alignClip_(const RCRect& r, int a) const {
+    auto floorTo = [a](int v) { return (v >= 0 ? v / a : -((-v + a - 1) / a)) * a; };
+    int x0 = floorTo(r.x), y0 = floorTo(r.y);
+    int x1 = floorTo(r.x + r.w + a - 1), y1 = floorTo(r.y + r.h + a - 1);
+    x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+    x1 = std::min(x1, width_); y1 = std::min(y1, height_);
+    return RCRect{x0, y0, x1 - x0, y1 - y0};
+  }
+
+  // For each dirty rect, cascade i must recompute every probe that
+  // - samples the changed scene: its center lies within range.y of the rect (+1 px for the
+  //   truncating texel lookup, +probeSize since any texel of the probe may be the one), or
+  // - merges from a recomputed probe of cascade i+1: the bilinear footprint reaches up to
+  //   2 * bilinearProbeSize away.
+  // Per-cascade results are coalesced so overlapping rects are dispatched once.
+  void computeDirtyRegions_(const std::vector<RCRect>& dirty, int numCascades) {
+    for (int i = 0; i < numCascades; ++i) regions_[i].clear();
+
+    for (const RCRect& d : dirty) {
+      if (d.empty()) continue;
+      RCRect above{};
+      for (int i = numCascades - 1; i >= 0; --i) {
+        const CascadeParamsStd140& c = params_.cascades[i];
+        const int reach = int(std::ceil(c.interval[1])) + 1 + c.geometry[0];
+        RCRect r = grow_(d, reach);
+        if (!above.empty()) r = unite_(r, grow_(above, 2 * c.geometry[1]));
+        r = alignClip_(r, c.geometry[0]);
+        if (!r.empty()) regions_[i].push_back(r);
+        above = r;
+      }
+    }
+
+    for (int i = 0; i < numCascades; ++i) {
+      std::vector<RCRect>& rs = regions_[i];
+      for (bool merged = true; merged; ) {
+        merged = false;
+        for (size_t a = 0; a < rs.size() && !merged; ++a) {
+          for (size_t b = a + 1; b < rs.size(); ++b) {
+            if (!touches_(rs[a], rs[b])) continue;
+            rs[a] = unite_(rs[a], rs[b]);
+            rs.erase(rs.begin() + long(b));
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  // One band of rows per cascade and frame. Texels are independent, so bands need not follow
+  // probe boundaries (a large probe may have some directions refreshed a frame later); equal
+  // heights keep the per-frame cost flat. Full-screen when temporal refresh is off.
+  void computeTemporalRegions_(int numCascades) {
+    const uint64_t frame = temporal_frame_;
+    if (temporal_.enabled) ++temporal_frame_;
+    for (int i = 0; i < numCascades; ++i) {
+      regions_[i].clear();
+      const int period = refreshPeriod(i);
+      if (period == 1) {
+        regions_[i].push_back(RCRect{0, 0, width_, height_});
+        continue;
+      }
+      const int band = (height_ + period - 1) / period;
+      const int y0   = int(frame % uint64_t(period)) * band;
+      const int y1   = std::min(y0 + band, height_);
+      if (y1 > y0) regions_[i].push_back(RCRect{0, y0, width_, y1 - y0});
+    }
+  }
+
+  void run_cascade_pass(int cascadeIndex, const RCRect& region) {
+    const bool tiled = cascadeIndex < shared_tile_cascades_;
+    const RCProgram& p = rc_programs_[int(active_format_)][variant_(tiled)];
+    const RCStorageFormatInfo& fi = rcStorageFormatInfo(active_format_);
+    const size_t out = size_t(cascadeIndex), in = out + 1;
+
+    state_.useProgram(p.pipeline.program());
+    glUniform1i(p.loc_cascade_index, cascadeIndex);
+    glUniform2i(p.loc_region_origin, region.x, region.y);
+    if (tiled) glUniform1i(p.loc_tile_apron, tileApron_(cascadeIndex));
+
+    // Scene and UBO stay bound across passes; cascade i reads i+1 and writes i
+    state_.bindUniformBuffer(p.ubo_binding, params_ubo_);
+    state_.bindTexture(p.unit_scene, scene_texture_);
+    state_.bindTexture(p.unit_input, cascade_tex_[in]);
+    if (fi.packRGB9E5) {
+      state_.bindImage(p.unit_output, view_tex_[out], 0, GL_WRITE_ONLY, GL_R32UI);
+    } else {
+      state_.bindImage(p.unit_output, cascade_tex_[out], 0, GL_WRITE_ONLY, fi.radiance);
+    }
+    if (fi.transmittance) {
+      state_.bindTexture(p.unit_trans_input, trans_tex_[in]);
+      state_.bindImage(p.unit_trans_output, trans_tex_[out], 0, GL_WRITE_ONLY, fi.transmittance);
+    }
+    if (active_preaverage_) state_.bindTexture(p.unit_preaveraged, preavg_tex_[in]);
+    if (activeSkipping_() == RCSpaceSkipping::DistanceField) state_.bindTexture(p.unit_distance, sdf_.distanceTex());
+    if (activeSkipping_() == RCSpaceSkipping::Occupancy)     state_.bindTexture(p.unit_occupancy, occupancy_.occupancyTex());
+    if (active_step_counters_) state_.bindStorageBuffer(p.ssbo_step_counters, step_counter_buf_);
+
+    // Dispatch over the region (workgroup size chosen independent of ray step schedule).
+    // Groups may overrun the region; those texels recompute to the same value, since every
+    // input outside the dirty footprint is already current.
+    GLuint gx = (GLuint)((region.w + 15) / 16);
+    GLuint gy = (GLuint)((region.h + 15) / 16);
     glDispatchCompute(gx, gy, 1);
+  }
 
-    // Ping-pong swap: next pass will sample 'cascade_input_' (previous output)
-    std::swap(cascade_input_, cascade_output_);
+  // Refresh the pre-averaged texels of cascade j whose probes intersect 'region' (cascade j
+  // texels), after cascade j itself was written
+  void run_preaverage_pass(int cascadeIndex, const RCRect& region) {
+    const RCProgram& p = preaverage_programs_[int(active_format_)];
+    const RCStorageFormatInfo& fi = rcStorageFormatInfo(active_format_);
+    const size_t j = size_t(cascadeIndex);
+    const int ps = params_.cascades[j].geometry[0], half = ps / 2;
+    const int x0 = region.x / ps * half,                 y0 = region.y / ps * half;
+    const int x1 = (region.x + region.w + ps - 1) / ps * half, y1 = (region.y + region.h + ps - 1) / ps * half;
+
+    state_.useProgram(p.pipeline.program());
+    glUniform1i(p.loc_cascade_index, cascadeIndex);
+    glUniform2i(p.loc_region_origin, x0, y0);
+    state_.bindUniformBuffer(p.ubo_binding, params_ubo_);
+    state_.bindTexture(p.unit_input, cascade_tex_[j]);
+    if (fi.transmittance) state_.bindTexture(p.unit_trans_input, trans_tex_[j]);
+    state_.bindImage(p.unit_preaveraged, preavg_tex_[j], 0, GL_WRITE_ONLY, preaveragedFormat_());
+
+    GLuint gx = (GLuint)((x1 - x0 + 15) / 16);
+    GLuint gy = (GLuint)((y1 - y0 + 15) / 16);
+    glDispatchCompute(gx, gy, 1);
   }
 
   void run_blit_to_display(const glm::ivec2& res) {
-    if (!blit_program_) blit_program_ = compileCompute_(blitCS_());
-    glUseProgram(blit_program_);
+    state_.useProgram(blit_pipeline_.program());
 
-    // Source: final RC in cascade_input_ (RGBA32F linear)
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, cascade_input_);
-    glUniform1i(glGetUniformLocation(blit_program_, "src"), 0);
-    glUniform2f(glGetUniformLocation(blit_program_, "resolution"), float(res.x), float(res.y));
+    // Source: final RC in cascade 0 (RGBA32F linear); resolution set in uploadCascadeParams_
+    state_.bindTexture(blit_unit_src_, resultTex());
 
     // Destination: RGBA8 display texture
-    glBindImageTexture(1, display_texture_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    state_.bindImage(blit_unit_dst_, display_texture_, 0, GL_WRITE_ONLY, GL_RGBA8);
 
     GLuint gx = (GLuint)((res.x + 15) / 16);
     GLuint gy = (GLuint)((res.y + 15) / 16);
@@ -221,53 +1003,326 @@ private:
   // RC compute shader (sampler2D inputs, imageStore output)
   // Intermediates remain linear; no OETF here (done in blitCS_).
   // ----------------------------
-  static const char* rcCS_() {
+  // Storage-format variants are selected by a #define preamble
+  static std::string rcDefines_(const RCStorageFormatInfo& fi) {
+    std::string defines = "#version 430\n";
+    defines += "#define RC_MAX_CASCADES " + std::to_string(kRCMaxCascades) + "\n";
+    if (fi.packRGB9E5) {
+      defines += "#define RC_PACK_RGB9E5\n";
+    } else {
+      defines += std::string("#define RC_OUTPUT_FORMAT ") + gpuFormatInfo(fi.radiance).imageQualifier + "\n";
+    }
+    if (fi.transmittance) {
+      defines += "#define RC_SPLIT_TRANSMITTANCE\n";
+      defines += std::string("#define RC_TRANSMITTANCE_FORMAT ") + gpuFormatInfo(fi.transmittance).imageQualifier + "\n";
+    }
+    return defines;
+  }
+
+  // Declarations shared by the cascade and pre-average passes: cascade input sampling and the
+  // per-cascade parameter block.
+  static const char* rcCommon_() {
     return R"(
-#version 430
+layout(binding = 1) uniform sampler2D cascadeInputTex;
+#ifdef RC_SPLIT_TRANSMITTANCE
+layout(binding = 3) uniform sampler2D transmittanceInputTex;
+#endif
+
+// Per-cascade parameters, uploaded once per configuration
+struct CascadeParams {
+  ivec4 geometry; // probeSize, bilinearProbeSize, steps
+  vec4  interval; // range start, range end
+};
+layout(std140, binding = 0) uniform CascadeBlock {
+  CascadeParams cascades[RC_MAX_CASCADES];
+  vec2 resolution;
+};
+
+uniform int   cascadeIndex;
+uniform ivec2 regionOrigin; // pixel offset of this dispatch (dirty-region updates)
+
+vec4 fetchCascade(ivec2 p) {
+#ifdef RC_SPLIT_TRANSMITTANCE
+  return vec4(texelFetch(cascadeInputTex, p, 0).rgb, texelFetch(transmittanceInputTex, p, 0).r);
+#else
+  return texelFetch(cascadeInputTex, p, 0);
+#endif
+}
+)";
+  }
+
+  static std::string rcCS_(const RCStorageFormatInfo& fi, int variant) {
+    std::string defines = rcDefines_(fi);
+    if (variant & kVariantPreaveraged) defines += "#define RC_PREAVERAGED\n";
+    if (variant & kVariantDistanceField) defines += "#define RC_DISTANCE_FIELD\n";
+    if (variant & kVariantOccupancy) defines += "#define RC_OCCUPANCY\n";
+    if (variant & kVariantGridDDA) defines += "#define RC_GRID_DDA\n";
+    if (variant & kVariantStepCounters) defines += "#define RC_STEP_COUNTERS\n";
+    if (variant & kVariantSharedTile) {
+      defines += "#define RC_SHARED_TILE " + std::to_string(sharedTileSize_(fi)) + "\n";
+      if (fi.scene != GL_RGBA32F) defines += "#define RC_SHARED_TILE_HALF\n";
+    }
+    return defines + rcCommon_() + R"(
 layout(local_size_x = 16, local_size_y = 16) in;
 
-// Inputs via sampler2D to leverage texture cache (linear RGBA32F)
-uniform sampler2D sceneTex;        // texture unit 0
-uniform sampler2D cascadeInputTex; // texture unit 1
+// Inputs via sampler2D to leverage texture cache (linear, any float storage format)
+layout(binding = 0) uniform sampler2D sceneTex;
+#ifdef RC_PREAVERAGED
+layout(binding = 4) uniform sampler2D preaveragedInputTex; // N+1 with child directions averaged
+#endif
+#ifdef RC_DISTANCE_FIELD
+layout(binding = 5) uniform sampler2D distanceTex; // pixels to the nearest occluder texel center
+#endif
+#ifdef RC_OCCUPANCY
+layout(binding = 6) uniform sampler2D occupancyTex; // mip k: any occupied texel in the cell
+#endif
 
 // Output via imageStore
-layout(binding = 2, rgba32f) uniform writeonly image2D cascadeOutput;
+#ifdef RC_PACK_RGB9E5
+layout(binding = 2, r32ui) uniform writeonly uimage2D cascadeOutput; // RGB9_E5 seen as R32UI
+#else
+layout(binding = 2, RC_OUTPUT_FORMAT) uniform writeonly image2D cascadeOutput;
+#endif
+
+// RGB-only formats keep transmittance in a separate single-channel texture
+#ifdef RC_SPLIT_TRANSMITTANCE
+layout(binding = 3, RC_TRANSMITTANCE_FORMAT) uniform writeonly image2D transmittanceOutput;
+#endif
+
+#ifdef RC_STEP_COUNTERS
+// 64-bit march iteration count per cascade as {lo, hi} pairs
+layout(std430, binding = 0) buffer StepCounters { uint cascadeSteps[]; };
+shared uint groupSteps;
+#endif
+uint marchSteps = 0u; // this invocation's march iterations
+
+#ifdef RC_PACK_RGB9E5
+// Shared-exponent encode as specified by EXT_texture_shared_exponent (N=9, B=15)
+uint packRGB9E5(vec3 c) {
+  const float maxValue = 65408.0; // (2^9 - 1) / 2^9 * 2^(31 - 15)
+  vec3  rc   = clamp(c, vec3(0.0), vec3(maxValue));
+  float maxc = max(rc.r, max(rc.g, rc.b));
+  float e    = max(-16.0, floor(log2(max(maxc, 1e-30)))) + 16.0;
+  float denom = exp2(e - 24.0);
+  if (floor(maxc / denom + 0.5) >= 512.0) { denom *= 2.0; e += 1.0; }
+  uvec3 m = uvec3(floor(rc / denom + 0.5));
+  return m.r | (m.g << 9) | (m.b << 18) | (uint(e) << 27);
+}
+#endif
+
+void storeCascade(ivec2 p, vec4 v) {
+#if defined(RC_PACK_RGB9E5)
+  imageStore(cascadeOutput, p, uvec4(packRGB9E5(v.rgb)));
+#else
+  imageStore(cascadeOutput, p, v);
+#endif
+#ifdef RC_SPLIT_TRANSMITTANCE
+  imageStore(transmittanceOutput, p, vec4(v.a));
+#endif
+}
 
-uniform int   cascadeIndex;
-uniform int   baseProbeSize;
-uniform float baseIntervalLength;
-uniform vec2  resolution;
-
-vec2 getIntervalRange(int cascadeIdx, float baseLength) {
-  float scaleCurrent = (cascadeIdx <= 0) ? 0.0 : float(1 << (2 * cascadeIdx));
-  float scaleNext    = float(1 << (2 * (cascadeIdx + 1)));
-  return baseLength * vec2(scaleCurrent, scaleNext);
+// Off-screen samples read as zero, which leaves the march unchanged
+vec4 fetchSceneGlobal(ivec2 ic) {
+  if (ic.x >= 0 && ic.x < int(resolution.x) && ic.y >= 0 && ic.y < int(resolution.y)) {
+    return texelFetch(sceneTex, ic, 0); // linear RGBA
+  }
+  return vec4(0.0);
 }
 
-vec4 castIntervalLinear(vec2 intervalStart, vec2 intervalEnd, int cascadeIdx) {
-  vec2 dir = intervalEnd - intervalStart;
+#ifdef RC_SHARED_TILE
+// Scene footprint of this workgroup plus the cascade's apron, loaded once before marching.
+// RC_SHARED_TILE is the largest edge that fits; each cascade loads only 16 + 2 * tileApron.
+uniform int tileApron;
+#ifdef RC_SHARED_TILE_HALF
+shared uvec2 sceneTile[RC_SHARED_TILE * RC_SHARED_TILE];
+#else
+shared vec4 sceneTile[RC_SHARED_TILE * RC_SHARED_TILE];
+#endif
+ivec2 tileOrigin;
+int   tileEdge;
+
+void loadSceneTile() {
+  tileEdge   = 16 + 2 * tileApron;
+  tileOrigin = regionOrigin + ivec2(gl_WorkGroupID.xy) * 16 - tileApron;
+  for (uint k = gl_LocalInvocationIndex; k < uint(tileEdge * tileEdge); k += 256u) {
+    vec4 s = fetchSceneGlobal(tileOrigin + ivec2(int(k) % tileEdge, int(k) / tileEdge));
+#ifdef RC_SHARED_TILE_HALF
+    sceneTile[k] = uvec2(packHalf2x16(s.rg), packHalf2x16(s.ba));
+#else
+    sceneTile[k] = s;
+#endif
+  }
+  memoryBarrierShared();
+  barrier();
+}
+#endif
+
+vec4 fetchScene(ivec2 ic) {
+#ifdef RC_SHARED_TILE
+  // Only cascades whose rays fit are dispatched with tiles; the check keeps any stray sample exact
+  ivec2 t = ic - tileOrigin;
+  if (uint(t.x) < uint(tileEdge) && uint(t.y) < uint(tileEdge)) {
+#ifdef RC_SHARED_TILE_HALF
+    uvec2 h = sceneTile[t.x + t.y * tileEdge];
+    return vec4(unpackHalf2x16(h.x), unpackHalf2x16(h.y));
+#else
+    return sceneTile[t.x + t.y * tileEdge];
+#endif
+  }
+#endif
+  return fetchSceneGlobal(ic);
+}
 
-  // Reference step schedule
-  int steps = 32 << cascadeIdx;
+#if defined(RC_DISTANCE_FIELD) || defined(RC_OCCUPANCY)
+bool onScreen(ivec2 ic) {
+  return ic.x >= 0 && ic.x < int(resolution.x) && ic.y >= 0 && ic.y < int(resolution.y);
+}
+
+// Radius around an off-screen 'coord' within which samples still truncate off screen
+float offscreenRadius(vec2 coord) {
+  return length(max(max(vec2(-1.0) - coord, coord - resolution), vec2(0.0)));
+}
+#endif
+
+#ifdef RC_DISTANCE_FIELD
+// Radius around 'coord' in which every sample reads an empty (alpha 0) texel. On screen: the
+// texel-center distance less sqrt(2) for the offsets of both points within their texels (and
+// a little for flood error).
+float freeRadius(vec2 coord, ivec2 ic) {
+  return onScreen(ic) ? texelFetch(distanceTex, ic, 0).r - 1.5 : offscreenRadius(coord);
+}
+#endif
+
+#ifdef RC_OCCUPANCY
+// Samples from 'coord' (inclusive) that stay inside the cell [lo, hi), at least 1. The exit
+// distance is shortened by 1/64 px so rounding of later sample positions cannot leave the cell.
+int stepsInCell(vec2 coord, vec2 stepSize, vec2 lo, vec2 hi, int steps) {
+  const float margin = 1.0 / 64.0;
+  vec2 tExit = vec2(float(steps));
+  if (stepSize.x > 0.0) tExit.x = (hi.x - coord.x - margin) / stepSize.x;
+  if (stepSize.x < 0.0) tExit.x = (coord.x - lo.x - margin) / -stepSize.x;
+  if (stepSize.y > 0.0) tExit.y = (hi.y - coord.y - margin) / stepSize.y;
+  if (stepSize.y < 0.0) tExit.y = (coord.y - lo.y - margin) / -stepSize.y;
+  float t = min(min(tExit.x, tExit.y), float(steps));
+  return max(int(ceil(t)), 1);
+}
+#endif
+
+vec4 castIntervalLinear(vec2 intervalStart, vec2 intervalEnd, int steps) {
+  vec2 dir = intervalEnd - intervalStart;
 
   vec2 stepSize = dir / float(steps);
 
   vec3 rad = vec3(0.0);
   float T  = 1.0;
+
+#ifdef RC_DISTANCE_FIELD
+  // Sphere trace over the uniform sample positions: each is computed from its index, so skips
+  // never shift a sample, and only samples within the free radius are skipped
+  float stepLength = length(stepSize);
+  for (int i = 0; i < steps && T > 0.001;) {
+    vec2  coord = intervalStart + stepSize * float(i);
+    ivec2 ic    = ivec2(coord);
+    float free  = freeRadius(coord, ic);
+    ++marchSteps;
+    if (free > 0.0) {
+      i += int(min(free / stepLength, float(steps))) + 1;
+      continue;
+    }
+    vec4 s = fetchScene(ic);
+    rad += s.rgb * (T * s.a);
+    T   *= (1.0 - s.a);
+    ++i;
+  }
+#elif defined(RC_OCCUPANCY)
+  // Walk the pyramid along the uniform sample positions: skip every sample inside an empty
+  // cell and try one level coarser next; descend on occupied cells; sample the scene at level 0
+  float stepLength = length(stepSize);
+  int topLevel = textureQueryLevels(occupancyTex) - 1;
+  int level = topLevel;
+  for (int i = 0; i < steps && T > 0.001;) {
+    vec2  coord = intervalStart + stepSize * float(i);
+    ivec2 ic    = ivec2(coord);
+    ++marchSteps;
+    if (!onScreen(ic)) {
+      i += int(min(offscreenRadius(coord) / stepLength, float(steps))) + 1;
+      level = topLevel;
+      continue;
+    }
+    if (level > 0) {
+      // Cells past the last one of a level (odd sizes) are folded into it; just descend there
+      ivec2 cell = ic >> level;
+      if (all(lessThan(cell, textureSize(occupancyTex, level))) && texelFetch(occupancyTex, cell, level).r == 0.0) {
+        i += stepsInCell(coord, stepSize, vec2(cell << level), vec2((cell + 1) << level), steps);
+        level = min(level + 1, topLevel);
+      } else {
+        --level;
+      }
+      continue;
+    }
+    vec4 s = fetchScene(ic);
+    rad += s.rgb * (T * s.a);
+    T   *= (1.0 - s.a);
+    ++i;
+    if (s.a == 0.0) level = min(1, topLevel);
+  }
+#else
   vec2 coord = intervalStart;
 
   for (int i = 0; i < steps && T > 0.001; ++i) {
-    ivec2 ic = ivec2(coord);
-    if (ic.x >= 0 && ic.x < int(resolution.x) && ic.y >= 0 && ic.y < int(resolution.y)) {
-      vec4 s = texelFetch(sceneTex, ic, 0); // linear RGBA
-      rad += s.rgb * (T * s.a);
-      T   *= (1.0 - s.a);
-    }
+    ++marchSteps;
+    vec4 s = fetchScene(ivec2(coord));
+    rad += s.rgb * (T * s.a);
+    T   *= (1.0 - s.a);
     coord += stepSize;
   }
+#endif
   return vec4(rad, T);
 }
 
+#ifdef RC_GRID_DDA
+// Amanatides-Woo traversal: every texel the segment crosses is sampled exactly once. The
+// segment is clipped to the screen first, since off-screen texels are empty.
+vec4 castIntervalDDA(vec2 a, vec2 b) {
+  vec3 rad = vec3(0.0);
+  float T  = 1.0;
+
+  vec2 d = b - a;
+  float t0 = 0.0, t1 = 1.0;
+  for (int k = 0; k < 2; ++k) {
+    if (d[k] == 0.0) {
+      if (a[k] < 0.0 || a[k] >= resolution[k]) return vec4(rad, T);
+      continue;
+    }
+    float ta = (0.0 - a[k]) / d[k], tb = (resolution[k] - a[k]) / d[k];
+    t0 = max(t0, min(ta, tb));
+    t1 = min(t1, max(ta, tb));
+  }
+  if (t0 >= t1) return vec4(rad, T);
+
+  vec2  p0   = a + d * t0;
+  vec2  p1   = a + d * t1;
+  ivec2 cell = clamp(ivec2(floor(p0)), ivec2(0), ivec2(resolution) - 1);
+  ivec2 last = clamp(ivec2(floor(p1)), ivec2(0), ivec2(resolution) - 1);
+  ivec2 stepDir = ivec2(sign(d));
+  vec2  tDelta  = vec2(d.x != 0.0 ? abs(1.0 / d.x) : 1e30, d.y != 0.0 ? abs(1.0 / d.y) : 1e30);
+  vec2  tMax    = vec2(
+    d.x > 0.0 ? (float(cell.x + 1) - a.x) / d.x : (d.x < 0.0 ? (float(cell.x) - a.x) / d.x : 1e30),
+    d.y > 0.0 ? (float(cell.y + 1) - a.y) / d.y : (d.y < 0.0 ? (float(cell.y) - a.y) / d.y : 1e30));
+
+  int count = abs(last.x - cell.x) + abs(last.y - cell.y) + 1;
+  for (int i = 0; i < count && T > 0.001; ++i) {
+    ++marchSteps;
+    vec4 s = fetchScene(cell);
+    rad += s.rgb * (T * s.a);
+    T   *= (1.0 - s.a);
+    if (tMax.x < tMax.y) { tMax.x += tDelta.x; cell.x += stepDir.x; }
+    else                 { tMax.y += tDelta.y; cell.y += stepDir.y; }
+  }
+  return vec4(rad, T);
+}
+#endif
+
 vec4 mergeIntervals(vec4 nearV, vec4 farV) {
   return vec4(nearV.rgb + farV.rgb * nearV.a, nearV.a * farV.a);
 }
@@ -283,13 +1338,18 @@ vec4 bilinearWeights(vec2 ratio) {
 
 ivec2 bilinearOffset(int idx) { return ivec2(idx & 1, idx >> 1); }
 
-void main() {
-  ivec2 pixelCoord = ivec2(gl_GlobalInvocationID.xy);
+void cascadeMain() {
+#ifdef RC_SHARED_TILE
+  // Every invocation takes part in the load, including those past the screen edge
+  loadSceneTile();
+#endif
+  ivec2 pixelCoord = regionOrigin + ivec2(gl_GlobalInvocationID.xy);
   if (pixelCoord.x >= int(resolution.x) || pixelCoord.y >= int(resolution.y)) return;
 
   // Probe geometry
-  int probeSize         = baseProbeSize << cascadeIndex;
-  int bilinearProbeSize = baseProbeSize << (cascadeIndex + 1);
+  CascadeParams params  = cascades[cascadeIndex];
+  int probeSize         = params.geometry.x;
+  int bilinearProbeSize = params.geometry.y;
   ivec2 dirCoord    = ivec2(pixelCoord.x % probeSize, pixelCoord.y % probeSize);
   ivec2 probeIndex  = pixelCoord / probeSize;
   vec2  probeCenter = vec2(probeIndex) + 0.5;
@@ -304,12 +1364,16 @@ void main() {
   vec2  dir   = vec2(cos(angle), sin(angle));
 
   // Destination interval
-  vec2 range = getIntervalRange(cascadeIndex, baseIntervalLength);
+  vec2 range = params.interval.xy;
+#ifdef RC_GRID_DDA
+  vec4 destInterval = castIntervalDDA(probePosition + dir * range.x, probePosition + dir * range.y);
+#else
   vec4 destInterval = castIntervalLinear(
     probePosition + dir * range.x,
     probePosition + dir * range.y,
-    cascadeIndex
+    params.geometry.z
   );
+#endif
 
   // Bilinear accumulation from N+1 (stored linear in cascadeInputTex)
   vec4 radiance = vec4(0.0);
@@ -323,6 +1387,21 @@ void main() {
     ivec2 bilinearIndex = baseIndex + baseOff;
     vec4 probe_contribution = vec4(0.0);
 
+    vec2 bilinearOff = vec2(bilinearIndex * bilinearProbeSize);
+    bilinearOff = clamp(bilinearOff, vec2(0.5), resolution - float(bilinearProbeSize));
+    ivec2 bilinearProbeOrigin = ivec2(bilinearOff);
+
+#ifdef RC_PREAVERAGED
+    // merge() is linear in the far interval, so merging the average of the 4 child directions
+    // equals averaging the 4 merges. Only probe-aligned offsets have a pre-averaged texel; the
+    // upper clamp on screens that are not a multiple of the probe size takes the full path.
+    if (bilinearProbeOrigin.x % bilinearProbeSize == 0 && bilinearProbeOrigin.y % bilinearProbeSize == 0) {
+      ivec2 avgTexel = (bilinearProbeOrigin / bilinearProbeSize) * probeSize + dirCoord;
+      radiance += mergeIntervals(destInterval, texelFetch(preaveragedInputTex, avgTexel, 0)) * weights[b];
+      continue;
+    }
+#endif
+
     for (int d = 0; d < 4; ++d) {
       int baseDirIndex     = dirIndex * 4;
       int bilinearDirIndex = baseDirIndex + d;
@@ -332,11 +1411,9 @@ void main() {
         bilinearDirIndex / bilinearProbeSize
       );
 
-      vec2 bilinearOff = vec2(bilinearIndex * bilinearProbeSize);
-      bilinearOff = clamp(bilinearOff, vec2(0.5), resolution - float(bilinearProbeSize));
-      ivec2 bilinearTexel = ivec2(bilinearOff) + bilinearDirCoord;
+      ivec2 bilinearTexel = bilinearProbeOrigin + bilinearDirCoord;
 
-      vec4 bilinearInterval = texelFetch(cascadeInputTex, bilinearTexel, 0); // linear
+      vec4 bilinearInterval = fetchCascade(bilinearTexel); // linear
       probe_contribution += mergeIntervals(destInterval, bilinearInterval) * weights[b];
     }
 
@@ -344,11 +1421,68 @@ void main() {
   }
 
   // Keep linear; sRGB encode happens in blitCS_
-  imageStore(cascadeOutput, pixelCoord, radiance);
+  storeCascade(pixelCoord, radiance);
+}
+
+void main() {
+#ifdef RC_STEP_COUNTERS
+  if (gl_LocalInvocationIndex == 0u) groupSteps = 0u;
+  memoryBarrierShared();
+  barrier();
+#endif
+  cascadeMain();
+#ifdef RC_STEP_COUNTERS
+  // Sum the group in shared memory, then one carry-propagating 64-bit add per group
+  atomicAdd(groupSteps, marchSteps);
+  memoryBarrierShared();
+  barrier();
+  if (gl_LocalInvocationIndex == 0u) {
+    uint old = atomicAdd(cascadeSteps[2 * cascadeIndex], groupSteps);
+    if (old + groupSteps < old) atomicAdd(cascadeSteps[2 * cascadeIndex + 1], 1u);
+  }
+#endif
 }
     )";
   }
 
+  // ----------------------------
+  // Pre-average compute shader: for cascade j (cascadeIndex), one texel per probe of j and
+  // direction of j-1, holding the mean of that direction's 4 child directions. Laid out on the
+  // probe grid of j with (j-1)-sized direction tiles, so it is about half size in each axis.
+  // ----------------------------
+  static std::string preaverageCS_(const RCStorageFormatInfo& fi, const char* outQualifier) {
+    return rcDefines_(fi) + rcCommon_() + R"(
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 4, )" + std::string(outQualifier) + R"() uniform writeonly image2D preaveragedOutput;
+
+void main() {
+  ivec2 q = regionOrigin + ivec2(gl_GlobalInvocationID.xy);
+  if (q.x >= imageSize(preaveragedOutput).x || q.y >= imageSize(preaveragedOutput).y) return;
+
+  int probeSize  = cascades[cascadeIndex].geometry.x;
+  int parentSize = probeSize >> 1;
+  ivec2 probeIndex = q / parentSize;
+  ivec2 parentDir  = q % parentSize;
+  int   dirIndex   = parentDir.x + parentDir.y * parentSize;
+  ivec2 origin     = probeIndex * probeSize;
+
+  // Probes cut by the screen edge are never read through this texture (see the merge)
+  if (origin.x + probeSize > int(resolution.x) || origin.y + probeSize > int(resolution.y)) {
+    imageStore(preaveragedOutput, q, vec4(0.0));
+    return;
+  }
+
+  vec4 sum = vec4(0.0);
+  for (int d = 0; d < 4; ++d) {
+    int childIndex = dirIndex * 4 + d;
+    sum += fetchCascade(origin + ivec2(childIndex % probeSize, childIndex / probeSize));
+  }
+  imageStore(preaveragedOutput, q, sum * 0.25);
+}
+)";
+  }
+
   // ----------------------------
   // Blit compute shader (linear RGBA32F -> sRGB RGBA8) for display
   // ----------------------------
@@ -357,7 +1491,7 @@ void main() {
 #version 430
 layout(local_size_x = 16, local_size_y = 16) in;
 
-uniform sampler2D src; // linear RGBA32F
+layout(binding = 0) uniform sampler2D src; // linear RGBA32F
 uniform vec2 resolution;
 layout(binding = 1, rgba8) uniform writeonly image2D dst;
 
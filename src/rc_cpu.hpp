@@ -0,0 +1,238 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// CPU reference Radiance Cascade renderer.
+// - Mirrors RCGPURenderer::rcCS_() (castIntervalLinear, mergeIntervals, bilinear N+1 merge)
+//   and GPUScene::CS() operation for operation, in float, so it can serve as a correctness
+//   oracle for the GPU path on machines without a compute-capable context.
+// - Multithreaded across texel rows; output is linear RGBA32F, same layout as resultTex().
+// - No GL dependency; include "validate.hpp" to diff against a GPU result.
+
+// Tightly packed RGBA32F image, row 0 first (matches glGetTexImage layout).
+struct CPUImageRGBA32F {
+  int width  = 0;
+  int height = 0;
+  std::vector<float> texels;
+
+  void resize(int w, int h) {
+    width = w; height = h;
+    texels.assign(size_t(w) * size_t(h) * 4u, 0.0f);
+  }
+
+  // texelFetch semantics; out-of-range fetches return zero.
+  glm::vec4 fetch(const glm::ivec2& p) const {
+    if (p.x < 0 || p.x >= width || p.y < 0 || p.y >= height) return glm::vec4(0.0f);
+    const float* t = &texels[(size_t(p.y) * size_t(width) + size_t(p.x)) * 4u];
+    return glm::vec4(t[0], t[1], t[2], t[3]);
+  }
+
+  void store(const glm::ivec2& p, const glm::vec4& v) {
+    float* t = &texels[(size_t(p.y) * size_t(width) + size_t(p.x)) * 4u];
+    t[0] = v.r; t[1] = v.g; t[2] = v.b; t[3] = v.a;
+  }
+};
+
+// Runs fn(y) for every row in [0, rows) on a pool of worker threads.
+// Rows are handed out dynamically since upper rows/cascades are not uniform in cost.
+template <typename Fn>
+inline void parallel_rows(int rows, unsigned numThreads, const Fn& fn) {
+  if (rows <= 0) return;
+  unsigned n = numThreads ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+  n = std::min<unsigned>(n, unsigned(rows));
+  if (n <= 1) {
+    for (int y = 0; y < rows; ++y) fn(y);
+    return;
+  }
+  std::atomic<int> next{0};
+  auto worker = [&]() {
+    for (int y = next.fetch_add(1); y < rows; y = next.fetch_add(1)) fn(y);
+  };
+  std::vector<std::thread> pool;
+  pool.reserve(n - 1);
+  for (unsigned i = 0; i + 1 < n; ++i) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+}
+
+// CPU mirror of GPUScene (single analytic circle, y-up frag coordinates).
+class CPUScene {
+public:
+  static void generate(CPUImageRGBA32F& scene,
+                       const glm::ivec2& res,
+                       float circleRadius,
+                       const glm::vec4& circleColor,
+                       unsigned numThreads = 0) {
+    scene.resize(res.x, res.y);
+    parallel_rows(res.y, numThreads, [&](int y) {
+      for (int x = 0; x < res.x; ++x) {
+        glm::vec2 frag(float(x) + 0.5f, float(res.y) - 0.5f - float(y));
+        glm::vec2 center = (glm::vec2(res) * 0.5f) - frag;
+        glm::vec4 radiance(0.0f);
+        if (glm::length(center) - circleRadius < 0.0f) radiance = circleColor;
+        scene.store(glm::ivec2(x, y), radiance);
+      }
+    });
+  }
+};
+
+class RCCPURenderer {
+public:
+  // numThreads == 0 uses std::thread::hardware_concurrency().
+  explicit RCCPURenderer(unsigned numThreads = 0) : num_threads_(numThreads) {}
+
+  // Same contract as RCGPURenderer::run_full_rc: scene generation followed by cascades N-1..0.
+  void run_full_rc(int baseProbeSize,
+                   float baseIntervalLength,
+                   int numCascades,
+                   const glm::ivec2& resolution) {
+    CPUScene::generate(scene_, resolution, /*circleRadius*/15.0f, /*circleColor*/glm::vec4(1, 1, 1, 1), num_threads_);
+
+    // Initial N+1 input is all zero, as on the GPU
+    cascade_input_.resize(resolution.x, resolution.y);
+    cascade_output_.resize(resolution.x, resolution.y);
+
+    for (int i = numCascades - 1; i >= 0; --i) {
+      run_cascade_pass(baseProbeSize, baseIntervalLength, i, resolution);
+    }
+  }
+
+  // Final linear RGBA32F after last pass (ping-pong leaves newest in cascade_input_)
+  const CPUImageRGBA32F& result() const { return cascade_input_; }
+  const CPUImageRGBA32F& scene() const { return scene_; }
+
+private:
+  unsigned num_threads_;
+  CPUImageRGBA32F scene_;
+  CPUImageRGBA32F cascade_input_;
+  CPUImageRGBA32F cascade_output_;
+
+  // ----------------------------
+  // Shader mirrors (see RCGPURenderer::rcCS_())
+  // ----------------------------
+  static glm::vec2 getIntervalRange(int cascadeIdx, float baseLength) {
+    float scaleCurrent = (cascadeIdx <= 0) ? 0.0f : float(1 << (2 * cascadeIdx));
+    float scaleNext    = float(1 << (2 * (cascadeIdx + 1)));
+    return baseLength * glm::vec2(scaleCurrent, scaleNext);
+  }
+
+  static glm::vec4 castIntervalLinear(const CPUImageRGBA32F& sceneTex,
+                                      const glm::vec2& intervalStart,
+                                      const glm::vec2& intervalEnd,
+                                      int cascadeIdx) {
+    glm::vec2 dir = intervalEnd - intervalStart;
+
+    // Reference step schedule
+    int steps = 32 << cascadeIdx;
+
+    glm::vec2 stepSize = dir / float(steps);
+
+    glm::vec3 rad(0.0f);
+    float T = 1.0f;
+    glm::vec2 coord = intervalStart;
+
+    for (int i = 0; i < steps && T > 0.001f; ++i) {
+      glm::ivec2 ic(coord);
+      if (ic.x >= 0 && ic.x < sceneTex.width && ic.y >= 0 && ic.y < sceneTex.height) {
+        glm::vec4 s = sceneTex.fetch(ic);
+        rad += glm::vec3(s.r, s.g, s.b) * (T * s.a);
+        T   *= (1.0f - s.a);
+      }
+      coord += stepSize;
+    }
+    return glm::vec4(rad, T);
+  }
+
+  static glm::vec4 mergeIntervals(const glm::vec4& nearV, const glm::vec4& farV) {
+    return glm::vec4(nearV.r + farV.r * nearV.a,
+                     nearV.g + farV.g * nearV.a,
+                     nearV.b + farV.b * nearV.a,
+                     nearV.a * farV.a);
+  }
+
+  static glm::vec4 bilinearWeights(const glm::vec2& ratio) {
+    return glm::vec4(
+      (1.0f - ratio.x) * (1.0f - ratio.y),
+       ratio.x * (1.0f - ratio.y),
+      (1.0f - ratio.x) *  ratio.y,
+       ratio.x *  ratio.y
+    );
+  }
+
+  static glm::ivec2 bilinearOffset(int idx) { return glm::ivec2(idx & 1, idx >> 1); }
+
+  void run_cascade_pass(int baseProbeSize, float baseIntervalLength, int cascadeIndex, const glm::ivec2& res) {
+    const glm::vec2 resolution(res);
+    const glm::vec2 range = getIntervalRange(cascadeIndex, baseIntervalLength);
+    const int probeSize         = baseProbeSize << cascadeIndex;
+    const int bilinearProbeSize = baseProbeSize << (cascadeIndex + 1);
+    const int dirCount          = probeSize * probeSize;
+    const float TWO_PI = 6.283185307179586f;
+
+    parallel_rows(res.y, num_threads_, [&](int y) {
+      for (int x = 0; x < res.x; ++x) {
+        glm::ivec2 pixelCoord(x, y);
+
+        // Probe geometry
+        glm::ivec2 dirCoord(pixelCoord.x % probeSize, pixelCoord.y % probeSize);
+        glm::ivec2 probeIndex(pixelCoord.x / probeSize, pixelCoord.y / probeSize);
+        glm::vec2  probeCenter = glm::vec2(probeIndex) + 0.5f;
+        glm::vec2  probePosition = probeCenter * float(probeSize);
+
+        int dirIndex = dirCoord.x + dirCoord.y * probeSize;
+
+        // Direction
+        float angle = TWO_PI * ((float(dirIndex) + 0.5f) / float(dirCount));
+        glm::vec2 dir(std::cos(angle), std::sin(angle));
+
+        // Destination interval
+        glm::vec4 destInterval = castIntervalLinear(
+          scene_,
+          probePosition + dir * range.x,
+          probePosition + dir * range.y,
+          cascadeIndex
+        );
+
+        // Bilinear accumulation from N+1
+        glm::vec4 radiance(0.0f);
+        glm::vec2 bilinearBaseCoord = (probePosition / float(bilinearProbeSize)) - glm::vec2(0.5f);
+        glm::vec2 ratio   = glm::fract(bilinearBaseCoord);
+        glm::vec4 weights = bilinearWeights(ratio);
+        glm::ivec2 baseIndex(glm::floor(bilinearBaseCoord));
+
+        for (int b = 0; b < 4; ++b) {
+          glm::ivec2 bilinearIndex = baseIndex + bilinearOffset(b);
+          glm::vec4 probe_contribution(0.0f);
+
+          for (int d = 0; d < 4; ++d) {
+            int bilinearDirIndex = dirIndex * 4 + d;
+
+            glm::ivec2 bilinearDirCoord(bilinearDirIndex % bilinearProbeSize,
+                                        bilinearDirIndex / bilinearProbeSize);
+
+            glm::vec2 bilinearOff = glm::vec2(bilinearIndex * bilinearProbeSize);
+            bilinearOff = glm::clamp(bilinearOff, glm::vec2(0.5f), resolution - float(bilinearProbeSize));
+            glm::ivec2 bilinearTexel = glm::ivec2(bilinearOff) + bilinearDirCoord;
+
+            glm::vec4 bilinearInterval = cascade_input_.fetch(bilinearTexel);
+            probe_contribution += mergeIntervals(destInterval, bilinearInterval) * weights[b];
+          }
+
+          radiance += probe_contribution * 0.25f;
+        }
+
+        cascade_output_.store(pixelCoord, radiance);
+      }
+    });
+
+    // Ping-pong swap: next pass reads cascade_input_ (previous output)
+    std::swap(cascade_input_, cascade_output_);
+  }
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// Upper bound on cascades: interval scale 4^(i+1) must stay representable as a 32-bit int shift.
+// Sizes the renderer's per-cascade state and the per-cascade GPU timings alike.
+static constexpr int kRCMaxCascades = 15;
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
+// Brute-force reference for arbitrary scenes: every pixel shoots rays in all directions from
+// its center and marches them to the screen edge with the emission/transmittance model of
+// castIntervalLinear (uniform samples of the nearest texel, rad += rgb * T * a, T *= 1 - a,
+// off-screen samples empty). Directions are stratified progressively: sample s of a pixel
+// uses the radical inverse of s, rotated per pixel, so every power-of-two prefix covers the
+// circle evenly.
+struct RCReferenceSettings {
+  int   raysPerPass = 16;     // rays added to each updated pixel by one advance()
+  int   rowsPerPass = 0;      // time slicing: rows updated by one advance(); 0 = whole image
+  float stepLength  = 0.25f;  // pixels between march samples
+  int   targetRays  = 4096;   // advance() stops once every pixel has this many; 0 = never
+};
+
+// Accumulates the reference across calls to advance(), a bounded slice of work each, so an
+// interactive caller can converge it in the background of the frame loop. resultTex() is the
+// running mean at all times (RGBA32F: radiance, mean transmittance), like RCGPURenderer's.
+// The caller restarts it with reset() when the scene changes.
+class RCReferenceIntegrator {
+public:
+  RCReferenceIntegrator() = default;
+  ~RCReferenceIntegrator() { cleanup(); }
+
+  RCReferenceIntegrator(const RCReferenceIntegrator&) = delete;
+  RCReferenceIntegrator& operator=(const RCReferenceIntegrator&) = delete;
+
+  // False while a background compiler (ProgramCache) is still building the program: call it
+  // again on a later frame. advance() does nothing until it succeeded.
+  bool initialize() {
+    if (pipeline_) return true;
+    if (failed_) return false;
+    const ProgramStatus status = acquirePipeline(pipeline_, integrateCS_(), "Reference");
+    if (status == ProgramStatus::Pending) return false;
+    if (status == ProgramStatus::Failed) {
+      std::cerr << "Failed to compile the reference integrator.\n";
+      failed_ = true;
+      return false;
+    }
+    loc_resolution_ = pipeline_.uniform("resolution");
+    loc_row_range_  = pipeline_.uniform("rowRange");
+    loc_first_      = pipeline_.uniform("firstSample");
+    loc_rays_       = pipeline_.uniform("rays");
+    loc_step_       = pipeline_.uniform("stepLength");
+    unit_scene_     = GLuint(pipeline_.binding("sceneTex"));
+    unit_accum_     = GLuint(pipeline_.binding("accum"));
+    return true;
+  }
+
+  // Takes effect at the next reset(), so one accumulation never mixes settings
+  void setSettings(const RCReferenceSettings& s) { pending_ = s; }
+  const RCReferenceSettings& settings() const { return pending_; }
+
+  // Restart the accumulation (scene or settings changed)
+  void reset() {
+    active_ = pending_;
+    active_.raysPerPass = std::max(active_.raysPerPass, 1);
+    active_.stepLength  = std::max(active_.stepLength, 1.0f / 64.0f);
+    sweeps_ = 0;
+    next_row_ = 0;
+  }
+
+  // One time slice: 'raysPerPass' more rays for the next 'rowsPerPass' rows of the image.
+  // Restarts on a resolution change. Returns false (and does nothing) once converged.
+  bool advance(GLuint sceneTex, const glm::ivec2& res) {
+    if (!pipeline_ || res.x <= 0 || res.y <= 0) return false;
+    if (resources_.ensureTexture2D(accum_, res.x, res.y, GL_RGBA32F) || res != res_) {
+      res_ = res;
+      reset();
+    }
+    if (converged()) return false;
+
+    const int rows = active_.rowsPerPass > 0 ? std::min(active_.rowsPerPass, res.y - next_row_) : res.y;
+    glUseProgram(pipeline_.program());
+    glUniform2f(loc_resolution_, float(res.x), float(res.y));
+    glUniform2i(loc_row_range_, next_row_, next_row_ + rows);
+    glUniform1ui(loc_first_, GLuint(sweeps_ * uint64_t(active_.raysPerPass)));
+    glUniform1i(loc_rays_, active_.raysPerPass);
+    glUniform1f(loc_step_, active_.stepLength);
+    glActiveTexture(GL_TEXTURE0 + unit_scene_);
+    glBindTexture(GL_TEXTURE_2D, sceneTex);
+    glBindImageTexture(unit_accum_, accum_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glDispatchCompute(GLuint((res.x + 15) / 16), GLuint((rows + 15) / 16), 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+    next_row_ += rows;
+    if (next_row_ >= res.y) {
+      next_row_ = 0;
+      ++sweeps_;
+    }
+    return true;
+  }
+
+  // Rays per pixel every pixel has (pixels of a partly done sweep have raysPerPass more)
+  uint64_t raysPerPixel() const { return sweeps_ * uint64_t(active_.raysPerPass); }
+  bool converged() const { return active_.targetRays > 0 && raysPerPixel() >= uint64_t(active_.targetRays); }
+
+  // Running mean; valid wherever at least one slice ran since the last reset()
+  GLuint resultTex() const { return accum_; }
+
+  void cleanup() {
+    resources_.releaseTexture(accum_);
+    pipeline_.reset();
+    res_ = glm::ivec2(0);
+  }
+
+private:
+  GpuResourceManager resources_;
+  ComputePipeline pipeline_;
+  bool   failed_ = false;
+  GLuint accum_ = 0;
+  glm::ivec2 res_{0, 0};
+  RCReferenceSettings pending_, active_;
+  uint64_t sweeps_ = 0;  // completed passes over all rows
+  int next_row_ = 0;
+  GLint  loc_resolution_ = -1, loc_row_range_ = -1, loc_first_ = -1, loc_rays_ = -1, loc_step_ = -1;
+  GLuint unit_scene_ = 0, unit_accum_ = 0;
+
+  static const char* integrateCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform sampler2D sceneTex;
+layout(binding = 0, rgba32f) uniform image2D accum;
+
+uniform vec2  resolution;
+uniform ivec2 rowRange;     // [first, end) rows of this slice
+uniform uint  firstSample;  // samples every pixel of the slice already has
+uniform int   rays;
+uniform float stepLength;
+
+vec4 fetchScene(ivec2 ic) {
+  if (ic.x >= 0 && ic.x < int(resolution.x) && ic.y >= 0 && ic.y < int(resolution.y)) {
+    return texelFetch(sceneTex, ic, 0);
+  }
+  return vec4(0.0);
+}
+
+// castIntervalLinear from 'origin' to where the ray leaves every texel ivec2() can reach
+vec4 castRay(vec2 origin, vec2 dir) {
+  vec2 lo = vec2(-1.0), hi = resolution + 1.0;
+  vec2 tExit = vec2(1e30);
+  if (dir.x != 0.0) tExit.x = max((lo.x - origin.x) / dir.x, (hi.x - origin.x) / dir.x);
+  if (dir.y != 0.0) tExit.y = max((lo.y - origin.y) / dir.y, (hi.y - origin.y) / dir.y);
+  int steps = int(ceil(min(tExit.x, tExit.y) / stepLength));
+
+  vec2 stepSize = dir * stepLength;
+  vec3 rad = vec3(0.0);
+  float T  = 1.0;
+  vec2 coord = origin;
+  for (int i = 0; i < steps && T > 0.001; ++i) {
+    vec4 s = fetchScene(ivec2(coord));
+    rad += s.rgb * (T * s.a);
+    T   *= (1.0 - s.a);
+    coord += stepSize;
+  }
+  return vec4(rad, T);
+}
+
+float radicalInverse(uint i) {
+  return float(bitfieldReverse(i)) * 2.3283064365386963e-10;
+}
+
+uint hash(uvec2 p) {
+  uint h = p.x * 0x8da6b343u ^ p.y * 0xd8163841u;
+  h ^= h >> 16; h *= 0x7feb352du;
+  h ^= h >> 15; h *= 0x846ca68bu;
+  return h ^ (h >> 16);
+}
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.x, int(gl_GlobalInvocationID.y) + rowRange.x);
+  if (p.x >= int(resolution.x) || p.y >= rowRange.y) return;
+
+  const float TWO_PI = 6.283185307179586;
+  vec2  origin = vec2(p) + 0.5;
+  float rotation = radicalInverse(hash(uvec2(p)));
+  vec4  sum = vec4(0.0);
+  for (int r = 0; r < rays; ++r) {
+    float angle = TWO_PI * fract(radicalInverse(firstSample + uint(r)) + rotation);
+    sum += castRay(origin, vec2(cos(angle), sin(angle)));
+  }
+
+  // Running mean over firstSample + rays samples
+  vec4 mean = firstSample == 0u ? vec4(0.0) : imageLoad(accum, p);
+  float w = float(rays) / (float(firstSample) + float(rays));
+  imageStore(accum, p, mean + (sum / float(rays) - mean) * w);
+}
+)";
+  }
+};
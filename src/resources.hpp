@@ -0,0 +1,292 @@
+#pragma once
+
+#include <unordered_map>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "program_cache.hpp"
+
+// Stall-free GPU resource manager.
+// - Texture/buffer size and format are tracked on the CPU, so "ensure" never queries the driver.
+// - Storage is immutable where available (glTexStorage2D / glBufferStorage); a size or format
+//   change deletes and recreates the object.
+// - Clears run entirely on the GPU (glClearTexImage / glClearBufferData, or a compute clear),
+//   so their CPU cost is constant and independent of resolution.
+
+// Client format/type used for GPU-side clears, plus the GLSL image qualifier for the compute fallback.
+struct GpuFormatInfo {
+  GLenum      clearFormat;
+  GLenum      clearType;
+  const char* imageQualifier;  // nullptr if the format is not image-storable
+};
+
+inline GpuFormatInfo gpuFormatInfo(GLenum internalFormat) {
+  switch (internalFormat) {
+    case GL_RGBA32F:        return {GL_RGBA, GL_FLOAT, "rgba32f"};
+    case GL_RGBA16F:        return {GL_RGBA, GL_FLOAT, "rgba16f"};
+    case GL_RGBA8:          return {GL_RGBA, GL_FLOAT, "rgba8"};
+    case GL_R11F_G11F_B10F: return {GL_RGB,  GL_FLOAT, "r11f_g11f_b10f"};
+    case GL_RG32F:          return {GL_RG,   GL_FLOAT, "rg32f"};
+    case GL_RG16F:          return {GL_RG,   GL_FLOAT, "rg16f"};
+    case GL_R32F:           return {GL_RED,  GL_FLOAT, "r32f"};
+    case GL_R16F:           return {GL_RED,  GL_FLOAT, "r16f"};
+    case GL_R16:            return {GL_RED,  GL_FLOAT, "r16"};
+    case GL_R8:             return {GL_RED,  GL_FLOAT, "r8"};
+    case GL_RGB9_E5:        return {GL_RGB,  GL_FLOAT, nullptr};
+    case GL_R32UI:          return {GL_RED_INTEGER, GL_UNSIGNED_INT, "r32ui"};
+    case GL_RG32I:          return {GL_RG_INTEGER,  GL_INT,          "rg32i"};
+    default:                return {GL_RGBA, GL_FLOAT, nullptr};
+  }
+}
+
+struct TextureDesc {
+  int    width  = 0;
+  int    height = 0;
+  int    levels = 1;
+  GLenum internalFormat = 0;
+  GLint  minFilter = 0, magFilter = 0, wrapS = 0, wrapT = 0;
+  uint64_t revision = 0;  // unique per allocation; GL may reuse the name after a delete
+};
+
+struct ViewDesc {
+  GLuint   source = 0;
+  GLenum   format = 0;
+  uint64_t revision = 0;  // source allocation the view was made from
+};
+
+struct BufferDesc {
+  GLsizeiptr size  = 0;
+  GLbitfield flags = 0;   // glBufferStorage flags
+};
+
+class GpuResourceManager {
+public:
+  GpuResourceManager() = default;
+  ~GpuResourceManager() { cleanup(); }
+
+  GpuResourceManager(const GpuResourceManager&) = delete;
+  GpuResourceManager& operator=(const GpuResourceManager&) = delete;
+
+  // Create 'tex' or recreate it if size/format/levels changed. Returns true if (re)allocated;
+  // contents are undefined in that case. Sampler state is only touched when it differs.
+  bool ensureTexture2D(GLuint& tex,
+                       int width,
+                       int height,
+                       GLenum internalFormat = GL_RGBA32F,
+                       GLint minFilter = GL_NEAREST,
+                       GLint magFilter = GL_NEAREST,
+                       GLint wrapS = GL_CLAMP_TO_EDGE,
+                       GLint wrapT = GL_CLAMP_TO_EDGE,
+                       int levels = 1) {
+    if (tex != 0) {
+      auto it = textures_.find(tex);
+      if (it != textures_.end()) {
+        TextureDesc& d = it->second;
+        if (d.width == width && d.height == height && d.internalFormat == internalFormat && d.levels == levels) {
+          if (d.minFilter != minFilter || d.magFilter != magFilter || d.wrapS != wrapS || d.wrapT != wrapT) {
+            glBindTexture(GL_TEXTURE_2D, tex);
+            setSampler_(d, minFilter, magFilter, wrapS, wrapT);
+          }
+          return false;
+        }
+      }
+      releaseTexture(tex);
+    }
+
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+      glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+    } else {
+      const GpuFormatInfo fi = gpuFormatInfo(internalFormat);
+      int w = width, h = height;
+      for (int l = 0; l < levels; ++l) {
+        glTexImage2D(GL_TEXTURE_2D, l, internalFormat, w, h, 0, fi.clearFormat, fi.clearType, nullptr);
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+      }
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
+
+    TextureDesc d;
+    d.width = width; d.height = height; d.levels = levels; d.internalFormat = internalFormat;
+    d.revision = ++revision_;
+    setSampler_(d, minFilter, magFilter, wrapS, wrapT);
+    textures_[tex] = d;
+    return true;
+  }
+
+  // Create 'buf' or recreate it if its size/flags changed. Returns true if (re)allocated.
+  // Default flags allow glBufferSubData and GPU-side clears.
+  bool ensureBuffer(GLuint& buf, GLsizeiptr size, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT) {
+    if (buf != 0) {
+      auto it = buffers_.find(buf);
+      if (it != buffers_.end() && it->second.size == size && it->second.flags == flags) return false;
+      releaseBuffer(buf);
+    }
+    glGenBuffers(1, &buf);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buf);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+      glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    } else {
+      glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    buffers_[buf] = BufferDesc{size, flags};
+    return true;
+  }
+
+  // Create or refresh a single-level 2D view of tracked immutable texture 'source', reinterpreting
+  // it as 'viewFormat' (same view class, e.g. RGB9_E5 seen as R32UI). Returns true if (re)created.
+  // Needs GL 4.3 / ARB_texture_view; returns false and leaves 'view' at 0 otherwise.
+  bool ensureTextureView(GLuint& view, GLuint source, GLenum viewFormat) {
+    auto src = textures_.find(source);
+    if (src == textures_.end()) return false;
+    if (view != 0) {
+      auto it = views_.find(view);
+      if (it != views_.end() && it->second.source == source && it->second.format == viewFormat &&
+          it->second.revision == src->second.revision) return false;
+      releaseTexture(view);
+    }
+    if (!(GLEW_VERSION_4_3 || GLEW_ARB_texture_view) || !(GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)) {
+      return false;
+    }
+    glGenTextures(1, &view);
+    glTextureView(view, GL_TEXTURE_2D, source, viewFormat, 0, 1, 0, 1);
+    views_[view] = ViewDesc{source, viewFormat, src->second.revision};
+    return true;
+  }
+
+  // Zero one level of a tracked texture on the GPU.
+  void clearTexture2D(GLuint tex, int level = 0) {
+    auto it = textures_.find(tex);
+    if (it == textures_.end()) return;
+    const TextureDesc& d = it->second;
+    const GpuFormatInfo fi = gpuFormatInfo(d.internalFormat);
+    if (GLEW_VERSION_4_4 || GLEW_ARB_clear_texture) {
+      glClearTexImage(tex, level, fi.clearFormat, fi.clearType, nullptr);  // nullptr -> zero
+      return;
+    }
+    computeClear_(tex, d, level, fi);
+  }
+
+  // Acquire the compute-clear fallback for 'internalFormat' ahead of its first clearTexture2D, so
+  // a frame never compiles it. Ready at once when nothing needs building (ARB_clear_texture, or
+  // a format without a clear path); Pending while the background compiler is on it.
+  ProgramStatus requestClearProgram(GLenum internalFormat) {
+    if (GLEW_VERSION_4_4 || GLEW_ARB_clear_texture) return ProgramStatus::Ready;
+    const GpuFormatInfo fi = gpuFormatInfo(internalFormat);
+    if (!fi.imageQualifier) return ProgramStatus::Ready;
+    ClearProgram& p = clear_programs_[internalFormat];
+    if (p.pipeline) return ProgramStatus::Ready;
+    if (p.failed) return ProgramStatus::Failed;
+    const ProgramStatus status = acquirePipeline(p.pipeline, clearCS_(fi.imageQualifier), "Clear");
+    p.failed = status == ProgramStatus::Failed;
+    return status;
+  }
+
+  // Zero a whole tracked buffer on the GPU (glClearBufferData is core in 4.3).
+  void clearBuffer(GLuint buf) {
+    if (buffers_.find(buf) == buffers_.end()) return;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buf);
+    glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  const TextureDesc* textureDesc(GLuint tex) const {
+    auto it = textures_.find(tex);
+    return it == textures_.end() ? nullptr : &it->second;
+  }
+  const BufferDesc* bufferDesc(GLuint buf) const {
+    auto it = buffers_.find(buf);
+    return it == buffers_.end() ? nullptr : &it->second;
+  }
+
+  void releaseTexture(GLuint& tex) {
+    if (!tex) return;
+    textures_.erase(tex);
+    views_.erase(tex);
+    glDeleteTextures(1, &tex);
+    tex = 0;
+  }
+  void releaseBuffer(GLuint& buf) {
+    if (!buf) return;
+    buffers_.erase(buf);
+    glDeleteBuffers(1, &buf);
+    buf = 0;
+  }
+
+  // Deletes every tracked object; requires the owning context to be current.
+  void cleanup() {
+    for (auto& kv : views_)    { GLuint t = kv.first; glDeleteTextures(1, &t); }
+    for (auto& kv : textures_) { GLuint t = kv.first; glDeleteTextures(1, &t); }
+    for (auto& kv : buffers_)  { GLuint b = kv.first; glDeleteBuffers(1, &b); }
+    textures_.clear();
+    views_.clear();
+    buffers_.clear();
+    clear_programs_.clear();
+  }
+
+private:
+  std::unordered_map<GLuint, TextureDesc> textures_;
+  std::unordered_map<GLuint, ViewDesc>    views_;
+  uint64_t                                revision_ = 0;
+  std::unordered_map<GLuint, BufferDesc>  buffers_;
+  struct ClearProgram {
+    ComputePipeline pipeline;
+    bool failed = false;
+  };
+  std::unordered_map<GLenum, ClearProgram> clear_programs_;  // compute-clear fallback, per format
+
+  static void setSampler_(TextureDesc& d, GLint minFilter, GLint magFilter, GLint wrapS, GLint wrapT) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+    d.minFilter = minFilter; d.magFilter = magFilter; d.wrapS = wrapS; d.wrapT = wrapT;
+  }
+
+  // Fallback for contexts without ARB_clear_texture: one imageStore of zero per texel.
+  void computeClear_(GLuint tex, const TextureDesc& d, int level, const GpuFormatInfo& fi) {
+    if (!fi.imageQualifier) {
+      std::cerr << "clearTexture2D: format 0x" << std::hex << d.internalFormat << std::dec
+                << " has no GPU clear path on this context.\n";
+      return;
+    }
+    // Blocks only for a format nobody requested (or one still being built)
+    ClearProgram& p = clear_programs_[d.internalFormat];
+    if (!p.pipeline && !p.failed) {
+      p.failed = acquirePipeline(p.pipeline, clearCS_(fi.imageQualifier), "Clear", /*wait*/true) == ProgramStatus::Failed;
+    }
+    if (p.failed) return;
+
+    const int w = std::max(1, d.width >> level);
+    const int h = std::max(1, d.height >> level);
+    glUseProgram(p.pipeline.program());
+    glUniform2i(0, w, h);
+    glBindImageTexture(0, tex, level, GL_FALSE, 0, GL_WRITE_ONLY, d.internalFormat);
+    glDispatchCompute(GLuint((w + 15) / 16), GLuint((h + 15) / 16), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+  }
+
+  static std::string clearCS_(const char* qualifier) {
+    const bool isUint = std::string(qualifier).find("ui") != std::string::npos;
+    const bool isInt  = !isUint && qualifier[std::string(qualifier).size() - 1] == 'i';
+    return
+      "#version 430\n"
+      "layout(local_size_x = 16, local_size_y = 16) in;\n"
+      "layout(location = 0) uniform ivec2 size;\n"
+      "layout(binding = 0, " + std::string(qualifier) + ") uniform writeonly " +
+      (isUint ? "uimage2D" : isInt ? "iimage2D" : "image2D") + " dst;\n"
+      "void main() {\n"
+      "  ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+      "  if (p.x >= size.x || p.y >= size.y) return;\n"
+      "  imageStore(dst, p, " + (isUint ? "uvec4(0u)" : isInt ? "ivec4(0)" : "vec4(0.0)") + ");\n"
+      "}\n";
+  }
+};
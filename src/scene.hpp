@@ -4,27 +4,158 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
-// Fills an RGBA32F texture with an analytical scene via a compute shader.
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
+// One scene primitive, std430 layout of the shader's Primitive (48 bytes). Coordinates are
+// pixels with y down, matching texel coordinates; a pixel is covered if its center is inside.
+enum ScenePrimitiveKind : uint32_t {
+  kSceneCircle  = 0,  // shape = center.xy, radius
+  kSceneBox     = 1,  // shape = center.xy, half extent.xy (axis aligned)
+  kSceneSegment = 2,  // shape = p0.xy, p1.xy; width = full thickness (capsule)
+};
+
+struct ScenePrimitive {
+  float    shape[4]    = {0, 0, 0, 0};
+  float    radiance[4] = {0, 0, 0, 0};  // linear rgb emission, a = opacity
+  float    width = 0.0f;
+  uint32_t kind  = kSceneCircle;
+  float    pad_[2] = {0, 0};
+};
+static_assert(sizeof(ScenePrimitive) == 48, "ScenePrimitive must match the std430 Primitive");
+
+// Deterministic test scene of 'count' small circles, boxes and segments drifting across 'res'
+// (wrapping at the edges) at 'time' seconds; about one in eight primitives emits, the rest only
+// occlude. Used by the headless tools to exercise large, moving primitive lists.
+inline void makeDriftingPrimitives(std::vector<ScenePrimitive>& out, size_t count, const glm::ivec2& res,
+                                   float time, uint32_t seed = 1) {
+  out.resize(count);
+  uint32_t state = seed * 747796405u + 2891336453u;
+  auto rnd = [&state]() {  // PCG-style hash, uniform in [0, 1)
+    state = state * 747796405u + 2891336453u;
+    uint32_t w = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return float((w >> 22u) ^ w) * (1.0f / 4294967296.0f);
+  };
+  const glm::vec2 size(res);
+  for (ScenePrimitive& p : out) {
+    const uint32_t kind = uint32_t(rnd() * 3.0f) % 3u;
+    glm::vec2 c = glm::vec2(rnd(), rnd()) * size + (glm::vec2(rnd(), rnd()) - 0.5f) * 64.0f * time;
+    c.x -= size.x * std::floor(c.x / size.x);
+    c.y -= size.y * std::floor(c.y / size.y);
+    const float extent = 1.5f + 6.0f * rnd();
+    p = ScenePrimitive{};
+    p.kind = kind;
+    if (kind == kSceneCircle) {
+      p.shape[0] = c.x; p.shape[1] = c.y; p.shape[2] = extent;
+    } else if (kind == kSceneBox) {
+      p.shape[0] = c.x; p.shape[1] = c.y; p.shape[2] = extent; p.shape[3] = 1.0f + extent * rnd();
+    } else {
+      const float a = 6.2831853f * rnd() + time;
+      const glm::vec2 d = glm::vec2(std::cos(a), std::sin(a)) * (2.0f * extent);
+      p.shape[0] = c.x - d.x; p.shape[1] = c.y - d.y; p.shape[2] = c.x + d.x; p.shape[3] = c.y + d.y;
+      p.width = 1.0f + 2.0f * rnd();
+    }
+    const bool emissive = rnd() < 0.125f;
+    p.radiance[0] = emissive ? 0.5f + 1.5f * rnd() : 0.0f;
+    p.radiance[1] = emissive ? 0.5f + 1.5f * rnd() : 0.0f;
+    p.radiance[2] = emissive ? 0.5f + 1.5f * rnd() : 0.0f;
+    p.radiance[3] = 1.0f;
+  }
+}
+
+// Fills an RGBA32F (or RGBA16F) texture with an analytical scene via a compute shader.
 // Writes linear radiance; no sRGB conversion.
+// Without primitives, draws the built-in circle. With primitives, later ones cover earlier
+// ones: primitives are binned per 16x16 tile first (count, prefix sum, fill into one compacted
+// list sized from the primitives' bounds), and each pixel only tests its tile's list.
 class GPUScene {
 public:
-  GPUScene() : prog_(0), u_resolution_(-1), u_radius_(-1), u_color_(-1) {}
-  ~GPUScene() { if (prog_) glDeleteProgram(prog_); }
+  static constexpr int kTileSize     = 16;
+  static constexpr int kRingSegments = 3;    // primitive upload buffers in flight
 
-  // Generate a simple scene into 'sceneTex' of size 'res'.
-  // sceneTex must be a GL_TEXTURE_2D with internal format GL_RGBA32F (or GL_RGBA16F if desired).
+  GPUScene() = default;
+  ~GPUScene() { releasePrimitives_(); }
+
+  GPUScene(const GPUScene&) = delete;
+  GPUScene& operator=(const GPUScene&) = delete;
+
+  // Primitives drawn by the next generate(); an empty list restores the built-in circle.
+  // Written straight into a persistently mapped ring segment the GPU is no longer reading.
+  void setPrimitives(const ScenePrimitive* prims, size_t count) {
+    primitive_count_ = 0;
+    bounds_.clear();
+    if (count == 0) return;
+    if (!ensurePrimitiveRing_(count)) return;
+    segment_ = (segment_ + 1) % kRingSegments;
+    waitSegment_(segment_);
+    const GLintptr offset = GLintptr(segment_) * segment_bytes_;
+    const GLsizeiptr bytes = GLsizeiptr(count * sizeof(ScenePrimitive));
+    if (mapped_) {
+      std::memcpy(mapped_ + offset, prims, size_t(bytes));
+    } else {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, prim_buf_);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, bytes, prims);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    bounds_.resize(count);
+    for (size_t i = 0; i < count; ++i) bounds_[i] = primitiveBounds_(prims[i]);
+    primitive_count_ = count;
+  }
+
+  size_t primitiveCount() const { return primitive_count_; }
+
+  // Animation time in seconds for the built-in circle, which orbits the screen center (at 0 it
+  // sits exactly on the center, the scene the CPU reference knows). Primitive lists animate
+  // through their contents instead (see makeDriftingPrimitives).
+  void setTime(float seconds) { time_ = seconds; }
+  float time() const { return time_; }
+
+  // Debug/validation: false makes every pixel test every primitive
+  void setBinning(bool enabled) { binning_ = enabled; }
+  bool binning() const { return binning_; }
+
+  // Acquire the programs the next generate() in 'format' needs (the primitive ones only while
+  // primitives are set). Pending while the background compiler is still on them; generate()
+  // draws nothing until then.
+  ProgramStatus requestPrograms(GLenum format) {
+    const ProgramStatus circle = ensureCircleProgram_(format);
+    return primitive_count_ > 0 ? combineStatus({circle, ensurePrimitivePrograms_(format)}) : circle;
+  }
+
+  // Generate the scene into 'sceneTex' of size 'res'.
+  // sceneTex must be a GL_TEXTURE_2D whose internal format is 'format' (GL_RGBA32F or GL_RGBA16F).
+  // circleRadius/circleColor describe the built-in circle used when no primitives are set.
   void generate(GLuint sceneTex,
                 const glm::ivec2& res,
                 float circleRadius,
-                const glm::vec4& circleColor) {
-    ensureProgram_();
-    glUseProgram(prog_);
+                const glm::vec4& circleColor,
+                GLenum format = GL_RGBA32F) {
+    if (primitive_count_ > 0) {
+      const ProgramStatus status = ensurePrimitivePrograms_(format);
+      if (status == ProgramStatus::Pending) return;
+      if (status == ProgramStatus::Ready) {
+        generatePrimitives_(sceneTex, res);
+        return;
+      }
+    }
+    if (ensureCircleProgram_(format) != ProgramStatus::Ready) return;
+    glUseProgram(circle_pipeline_.program());
     glUniform2f(u_resolution_, float(res.x), float(res.y));
     glUniform1f(u_radius_, circleRadius);
     glUniform4f(u_color_, circleColor.r, circleColor.g, circleColor.b, circleColor.a);
+    glUniform1f(u_time_, time_);
 
     // Bind as image for write
-    glBindImageTexture(0, sceneTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(0, sceneTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, circle_format_);
 
     GLuint gx = (GLuint)((res.x + 15) / 16);
     GLuint gy = (GLuint)((res.y + 15) / 16);
@@ -35,54 +166,240 @@ public:
   }
 
 private:
-  GLuint prog_;
-  GLint  u_resolution_;
-  GLint  u_radius_;
-  GLint  u_color_;
-
-  static GLuint compileCompute_(const char* src) {
-    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(cs, 1, &src, nullptr);
-    glCompileShader(cs);
-    GLint ok = GL_FALSE;
-    glGetShaderiv(cs, GL_COMPILE_STATUS, &ok);
-    if (!ok) {
-      char log[4096];
-      glGetShaderInfoLog(cs, 4096, nullptr, log);
-      glDeleteShader(cs);
-      return 0;
-    }
-    GLuint prog = glCreateProgram();
-    glAttachShader(prog, cs);
-    glLinkProgram(prog);
-    glDeleteShader(cs);
-    glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-    if (!ok) {
-      glDeleteProgram(prog);
-      return 0;
-    }
-    return prog;
-  }
-
-  void ensureProgram_() {
-    if (prog_) return;
-    prog_ = compileCompute_(CS());
-    // Cache uniform locations
-    glUseProgram(prog_);
-    u_resolution_ = glGetUniformLocation(prog_, "resolution");
-    u_radius_     = glGetUniformLocation(prog_, "circleRadius");
-    u_color_      = glGetUniformLocation(prog_, "circleColor");
-  }
-
-  static const char* CS() {
-    return R"(
+  ComputePipeline circle_pipeline_;
+  GLenum circle_format_ = 0;  // image format circle_pipeline_ is (being) built for
+  bool   circle_failed_ = false;
+  GLint  u_resolution_ = -1;
+  GLint  u_radius_ = -1;
+  GLint  u_color_ = -1;
+  GLint  u_time_ = -1;
+  float  time_ = 0.0f;
+
+  // ----------------------------
+  // Primitive path
+  // ----------------------------
+  GpuResourceManager resources_;
+  ComputePipeline bin_pipeline_, scan_pipeline_, raster_pipeline_;
+  GLenum   raster_format_ = 0;
+  bool     primitive_programs_failed_ = false;
+  GLuint   prim_buf_ = 0;
+  uint8_t* mapped_ = nullptr;         // persistent coherent mapping, or null (glBufferSubData)
+  GLsizeiptr segment_bytes_ = 0;      // aligned size of one ring segment
+  size_t   segment_capacity_ = 0;     // primitives per segment
+  int      segment_ = 0;              // segment holding the current primitives
+  GLsync   fences_[kRingSegments] = {nullptr, nullptr, nullptr};
+  size_t   primitive_count_ = 0;
+  bool     binning_ = true;
+  GLuint   tile_count_buf_ = 0, tile_start_buf_ = 0, tile_list_buf_ = 0;
+  size_t   tile_list_capacity_ = 0;   // references tile_list_buf_ holds
+  int      tiles_x_ = 0, tiles_y_ = 0;
+  std::vector<glm::vec4> bounds_;     // pixel-space bounds of the current primitives
+
+  // Bounds as the shader's primitiveBounds computes them
+  static glm::vec4 primitiveBounds_(const ScenePrimitive& p) {
+    const float* s = p.shape;
+    if (p.kind == kSceneCircle) return glm::vec4(s[0] - s[2], s[1] - s[2], s[0] + s[2], s[1] + s[2]);
+    if (p.kind == kSceneBox)    return glm::vec4(s[0] - s[2], s[1] - s[3], s[0] + s[2], s[1] + s[3]);
+    const float r = 0.5f * p.width;
+    return glm::vec4(std::min(s[0], s[2]) - r, std::min(s[1], s[3]) - r, std::max(s[0], s[2]) + r, std::max(s[1], s[3]) + r);
+  }
+
+  // References the bin pass writes: the clamped tile span of every primitive on screen
+  size_t tileReferences_(const glm::ivec2& res) const {
+    size_t total = 0;
+    for (const glm::vec4& b : bounds_) {
+      if (b.z < 0.0f || b.w < 0.0f || b.x >= float(res.x) || b.y >= float(res.y)) continue;
+      auto tile = [](float v, int last) { return std::min(std::max(int(std::floor(v / float(kTileSize))), 0), last); };
+      const int x0 = tile(b.x, tiles_x_ - 1), x1 = tile(b.z, tiles_x_ - 1);
+      const int y0 = tile(b.y, tiles_y_ - 1), y1 = tile(b.w, tiles_y_ - 1);
+      total += size_t(x1 - x0 + 1) * size_t(y1 - y0 + 1);
+    }
+    return total;
+  }
+
+  bool ensurePrimitiveRing_(size_t count) {
+    if (count <= segment_capacity_) return true;
+    // Growing replaces the buffer; nothing may still read the old one
+    for (int i = 0; i < kRingSegments; ++i) waitSegment_(i);
+    releasePrimitiveBuffer_();
+
+    size_t capacity = std::max<size_t>(segment_capacity_ * 2, 1024);
+    while (capacity < count) capacity *= 2;
+    GLint align = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align);
+    align = std::max(align, 1);
+    segment_bytes_ = GLsizeiptr((capacity * sizeof(ScenePrimitive) + size_t(align) - 1) / size_t(align) * size_t(align));
+    segment_capacity_ = capacity;
+
+    const GLsizeiptr total = segment_bytes_ * kRingSegments;
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+      const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      resources_.ensureBuffer(prim_buf_, total, flags);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, prim_buf_);
+      mapped_ = static_cast<uint8_t*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, total, flags));
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    } else {
+      resources_.ensureBuffer(prim_buf_, total);
+    }
+    if (!prim_buf_) {
+      std::cerr << "Failed to allocate the scene primitive buffer.\n";
+      segment_capacity_ = 0;
+      return false;
+    }
+    return true;
+  }
+
+  void waitSegment_(int i) {
+    if (!fences_[i]) return;
+    while (glClientWaitSync(fences_[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fences_[i]);
+    fences_[i] = nullptr;
+  }
+
+  void releasePrimitiveBuffer_() {
+    if (mapped_) {
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, prim_buf_);
+      glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      mapped_ = nullptr;
+    }
+    resources_.releaseBuffer(prim_buf_);
+  }
+
+  void releasePrimitives_() {
+    for (GLsync& f : fences_) if (f) { glDeleteSync(f); f = nullptr; }
+    releasePrimitiveBuffer_();
+    resources_.releaseBuffer(tile_count_buf_);
+    resources_.releaseBuffer(tile_start_buf_);
+    resources_.releaseBuffer(tile_list_buf_);
+    tile_list_capacity_ = 0;
+    bin_pipeline_.reset();
+    scan_pipeline_.reset();
+    raster_pipeline_.reset();
+    segment_capacity_ = 0;
+  }
+
+  // Bin, scan and raster programs; a failure drops the primitives (the circle is drawn instead)
+  ProgramStatus ensurePrimitivePrograms_(GLenum format) {
+    if (primitive_programs_failed_) {
+      primitive_count_ = 0;
+      return ProgramStatus::Failed;
+    }
+    if (raster_format_ != format) {
+      raster_pipeline_.reset();
+      raster_format_ = format;
+    }
+    const ProgramStatus status = combineStatus({
+      acquirePipeline(bin_pipeline_, binCS_(), "Scene"),
+      acquirePipeline(scan_pipeline_, scanCS_(), "Scene"),
+      acquirePipeline(raster_pipeline_, rasterCS_(format == GL_RGBA16F ? "rgba16f" : "rgba32f"), "Scene")});
+    if (status == ProgramStatus::Failed) {
+      std::cerr << "Failed to compile the scene primitive programs.\n";
+      primitive_programs_failed_ = true;
+      primitive_count_ = 0;
+    }
+    return status;
+  }
+
+  void generatePrimitives_(GLuint sceneTex, const glm::ivec2& res) {
+    const GLintptr   offset = GLintptr(segment_) * segment_bytes_;
+    const GLsizeiptr bytes  = GLsizeiptr(primitive_count_ * sizeof(ScenePrimitive));
+    const int count = int(primitive_count_);
+
+    tiles_x_ = (res.x + kTileSize - 1) / kTileSize;
+    tiles_y_ = (res.y + kTileSize - 1) / kTileSize;
+    const size_t tiles = size_t(tiles_x_) * size_t(tiles_y_);
+    resources_.ensureBuffer(tile_count_buf_, GLsizeiptr(tiles * sizeof(uint32_t)));
+    resources_.ensureBuffer(tile_start_buf_, GLsizeiptr(tiles * sizeof(uint32_t)));
+    // The list only grows, so drifting primitives do not reallocate it every frame
+    const size_t references = binning_ ? tileReferences_(res) : 0;
+    if (!tile_list_buf_ || references > tile_list_capacity_) {
+      tile_list_capacity_ = std::max<size_t>(tile_list_capacity_ * 2, 1024);
+      while (tile_list_capacity_ < references) tile_list_capacity_ *= 2;
+      resources_.ensureBuffer(tile_list_buf_, GLsizeiptr(tile_list_capacity_ * sizeof(uint32_t)));
+    }
+
+    // Bin: count the primitives per tile, turn the counts into list offsets, then append every
+    // primitive to each tile its bounds overlap
+    if (binning_) {
+      resources_.clearBuffer(tile_count_buf_);
+      glUseProgram(bin_pipeline_.program());
+      glUniform2i(bin_pipeline_.uniform("resolution"), res.x, res.y);
+      glUniform2i(bin_pipeline_.uniform("tileGrid"), tiles_x_, tiles_y_);
+      glUniform1i(bin_pipeline_.uniform("primitiveCount"), count);
+      glUniform1ui(bin_pipeline_.uniform("listCapacity"), GLuint(tile_list_capacity_));
+      glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GLuint(bin_pipeline_.binding("Primitives")), prim_buf_, offset, bytes);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(bin_pipeline_.binding("TileCounts")), tile_count_buf_);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(bin_pipeline_.binding("TileStarts")), tile_start_buf_);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(bin_pipeline_.binding("TileLists")), tile_list_buf_);
+      const GLint fill = bin_pipeline_.uniform("fillPass");
+      glUniform1i(fill, 0);
+      glDispatchCompute(GLuint((count + 63) / 64), 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      glUseProgram(scan_pipeline_.program());
+      glUniform2i(scan_pipeline_.uniform("tileGrid"), tiles_x_, tiles_y_);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(scan_pipeline_.binding("TileCounts")), tile_count_buf_);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(scan_pipeline_.binding("TileStarts")), tile_start_buf_);
+      glDispatchCompute(1, 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      glUseProgram(bin_pipeline_.program());
+      glUniform1i(fill, 1);
+      glDispatchCompute(GLuint((count + 63) / 64), 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    // Raster: one workgroup per tile
+    glUseProgram(raster_pipeline_.program());
+    glUniform2i(raster_pipeline_.uniform("resolution"), res.x, res.y);
+    glUniform2i(raster_pipeline_.uniform("tileGrid"), tiles_x_, tiles_y_);
+    glUniform1i(raster_pipeline_.uniform("primitiveCount"), count);
+    glUniform1i(raster_pipeline_.uniform("useBins"), binning_ ? 1 : 0);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, GLuint(raster_pipeline_.binding("Primitives")), prim_buf_, offset, bytes);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(raster_pipeline_.binding("TileCounts")), tile_count_buf_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(raster_pipeline_.binding("TileStarts")), tile_start_buf_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GLuint(raster_pipeline_.binding("TileLists")), tile_list_buf_);
+    glBindImageTexture(GLuint(raster_pipeline_.binding("sceneImage")), sceneTex, 0, GL_FALSE, 0, GL_WRITE_ONLY, raster_format_);
+    glDispatchCompute(GLuint(tiles_x_), GLuint(tiles_y_), 1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // The segment may be rewritten once these passes are done with it
+    if (fences_[segment_]) glDeleteSync(fences_[segment_]);
+    fences_[segment_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  ProgramStatus ensureCircleProgram_(GLenum format) {
+    if (circle_format_ != format) {
+      circle_pipeline_.reset();
+      circle_format_ = format;
+      circle_failed_ = false;
+    }
+    if (circle_pipeline_) return ProgramStatus::Ready;
+    if (circle_failed_) return ProgramStatus::Failed;
+    const ProgramStatus status = acquirePipeline(circle_pipeline_, CS(format == GL_RGBA16F ? "rgba16f" : "rgba32f"), "Scene");
+    if (status == ProgramStatus::Failed) {
+      std::cerr << "Failed to compile the scene program.\n";
+      circle_failed_ = true;
+    }
+    if (status != ProgramStatus::Ready) return status;
+    u_resolution_ = circle_pipeline_.uniform("resolution");
+    u_radius_     = circle_pipeline_.uniform("circleRadius");
+    u_color_      = circle_pipeline_.uniform("circleColor");
+    u_time_       = circle_pipeline_.uniform("time");
+    return status;
+  }
+
+  static std::string CS(const char* qualifier) {
+    return std::string(R"(
 #version 430
 layout(local_size_x = 16, local_size_y = 16) in;
 
-layout(binding = 0, rgba32f) uniform writeonly image2D sceneImage;
+layout(binding = 0, )") + qualifier + R"() uniform writeonly image2D sceneImage;
 uniform vec2  resolution;
 uniform float circleRadius;
 uniform vec4  circleColor;
+uniform float time;
 
 void main() {
   ivec2 p = ivec2(gl_GlobalInvocationID.xy);
@@ -90,7 +407,9 @@ void main() {
 
   // gl_FragCoord-like center with y up (match RC compute path)
   vec2 frag = vec2(float(p.x) + 0.5, resolution.y - 0.5 - float(p.y));
-  vec2 center = (resolution * 0.5) - frag;
+  // Lissajous orbit over a quarter of the smaller side; zero offset at time 0
+  vec2 orbit = vec2(sin(0.9 * time), sin(0.6 * time)) * (0.25 * min(resolution.x, resolution.y));
+  vec2 center = (resolution * 0.5 + orbit) - frag;
 
   vec4 radiance = vec4(0.0);
   if (length(center) - circleRadius < 0.0) {
@@ -101,4 +420,147 @@ void main() {
 }
     )";
   }
+
+  // Primitive declarations and geometry shared by the bin and raster passes
+  static std::string primitiveCommon_() {
+    return "#version 430\n#define TILE_SIZE " + std::to_string(kTileSize) + R"(
+struct Primitive {
+  vec4  shape;
+  vec4  radiance;
+  float width;
+  uint  kind;
+  float pad0, pad1;
+};
+layout(std430, binding = 0) readonly buffer Primitives { Primitive prims[]; };
+layout(std430, binding = 1) buffer TileCounts { uint tileCount[]; };
+layout(std430, binding = 2) buffer TileLists  { uint tileList[]; };   // compacted, per tile from tileStart
+layout(std430, binding = 3) buffer TileStarts { uint tileStart[]; };
+
+uniform ivec2 resolution;
+uniform ivec2 tileGrid;
+uniform int   primitiveCount;
+
+// Pixel-space bounds (min.xy, max.xy) of the covered region
+vec4 primitiveBounds(Primitive p) {
+  if (p.kind == 0u) return vec4(p.shape.xy - p.shape.z, p.shape.xy + p.shape.z);
+  if (p.kind == 1u) return vec4(p.shape.xy - p.shape.zw, p.shape.xy + p.shape.zw);
+  float r = 0.5 * p.width;
+  return vec4(min(p.shape.xy, p.shape.zw) - r, max(p.shape.xy, p.shape.zw) + r);
+}
+
+bool covers(Primitive p, vec2 c) {
+  if (p.kind == 0u) return length(c - p.shape.xy) < p.shape.z;
+  if (p.kind == 1u) return all(lessThan(abs(c - p.shape.xy), p.shape.zw));
+  vec2 ab = p.shape.zw - p.shape.xy;
+  float t = clamp(dot(c - p.shape.xy, ab) / max(dot(ab, ab), 1e-12), 0.0, 1.0);
+  return length(c - (p.shape.xy + ab * t)) < 0.5 * p.width;
+}
+)";
+  }
+
+  static std::string binCS_() {
+    return primitiveCommon_() + R"(
+layout(local_size_x = 64) in;
+
+// Pass 0 counts references per tile; pass 1 (after the scan reset the counts) recounts them to
+// get each reference's slot in the tile's range of the list
+uniform int  fillPass;
+uniform uint listCapacity;
+
+void main() {
+  int i = int(gl_GlobalInvocationID.x);
+  if (i >= primitiveCount) return;
+  vec4 b = primitiveBounds(prims[i]);
+  if (b.z < 0.0 || b.w < 0.0 || b.x >= float(resolution.x) || b.y >= float(resolution.y)) return;
+
+  ivec2 t0 = clamp(ivec2(floor(b.xy / float(TILE_SIZE))), ivec2(0), tileGrid - 1);
+  ivec2 t1 = clamp(ivec2(floor(b.zw / float(TILE_SIZE))), ivec2(0), tileGrid - 1);
+  for (int ty = t0.y; ty <= t1.y; ++ty)
+  for (int tx = t0.x; tx <= t1.x; ++tx) {
+    uint tile = uint(ty * tileGrid.x + tx);
+    uint slot = atomicAdd(tileCount[tile], 1u);
+    if (fillPass != 0 && tileStart[tile] + slot < listCapacity) tileList[tileStart[tile] + slot] = uint(i);
+  }
+}
+)";
+  }
+
+  // Exclusive prefix sum of the tile counts into tileStart, in one workgroup: each invocation
+  // sums a contiguous run of tiles, the run totals are scanned in shared memory, and each run is
+  // then written out. Counts are reset for the fill pass.
+  static std::string scanCS_() {
+    return primitiveCommon_() + R"(
+layout(local_size_x = 256) in;
+
+shared uint runTotal[256];
+
+void main() {
+  uint li = gl_LocalInvocationIndex;
+  uint tiles = uint(tileGrid.x * tileGrid.y);
+  uint per = (tiles + 255u) / 256u;
+  uint begin = min(li * per, tiles), end = min(begin + per, tiles);
+  uint sum = 0u;
+  for (uint k = begin; k < end; ++k) sum += tileCount[k];
+  runTotal[li] = sum;
+  barrier();
+  // Inclusive Hillis-Steele scan of the run totals
+  for (uint d = 1u; d < 256u; d <<= 1) {
+    uint v = li >= d ? runTotal[li - d] : 0u;
+    barrier();
+    runTotal[li] += v;
+    barrier();
+  }
+  uint start = li > 0u ? runTotal[li - 1u] : 0u;
+  for (uint k = begin; k < end; ++k) {
+    tileStart[k] = start;
+    start += tileCount[k];
+    tileCount[k] = 0u;
+  }
+}
+)";
+  }
+
+  static std::string rasterCS_(const char* qualifier) {
+    return primitiveCommon_() + R"(
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+layout(binding = 0, )" + std::string(qualifier) + R"() uniform writeonly image2D sceneImage;
+uniform int useBins;
+
+#define BATCH (TILE_SIZE * TILE_SIZE)
+shared uint tilePrims[BATCH];
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  bool inside = p.x < resolution.x && p.y < resolution.y;
+  vec2 c = vec2(p) + 0.5;
+
+  // The highest-index covering primitive wins, independent of list order
+  int best = -1;
+  if (useBins != 0) {
+    // The tile's list goes through shared memory one batch at a time
+    uint tile  = gl_WorkGroupID.y * uint(tileGrid.x) + gl_WorkGroupID.x;
+    uint count = tileCount[tile], start = tileStart[tile];
+    for (uint base = 0u; base < count; base += uint(BATCH)) {
+      uint n = min(count - base, uint(BATCH));
+      barrier();
+      if (gl_LocalInvocationIndex < n) tilePrims[gl_LocalInvocationIndex] = tileList[start + base + gl_LocalInvocationIndex];
+      memoryBarrierShared();
+      barrier();
+      if (inside) {
+        for (uint k = 0u; k < n; ++k) {
+          int i = int(tilePrims[k]);
+          if (i > best && covers(prims[i], c)) best = i;
+        }
+      }
+    }
+  } else if (inside) {
+    for (int i = primitiveCount - 1; i >= 0; --i) {
+      if (covers(prims[i], c)) { best = i; break; }
+    }
+  }
+  if (inside) imageStore(sceneImage, p, best >= 0 ? prims[best].radiance : vec4(0.0));
+}
+)";
+  }
 };
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "image_io.hpp"
+
+// Scene texture sourced from files (see SceneImageKind) instead of GPUScene.
+// load() memory-maps a file and decodes it straight into one half of a persistently mapped
+// pixel-unpack buffer; upload() copies that half into the scene texture on the GPU. The two
+// halves alternate, so loading frame N+1 of a sequence (CPU) overlaps the upload and cascade
+// passes of frame N (GPU); a half is only rewritten once the fence of its last upload passed.
+class SceneImageImporter {
+public:
+  static constexpr int kBuffers = 2;
+
+  SceneImageImporter() = default;
+  ~SceneImageImporter() { cleanup(); }
+
+  SceneImageImporter(const SceneImageImporter&) = delete;
+  SceneImageImporter& operator=(const SceneImageImporter&) = delete;
+
+  // Stage 'path' for the next upload. Raw files must be exactly 'rawRes' RGBA32F texels.
+  bool load(const std::string& path, const glm::ivec2& rawRes) {
+    MappedFile file;
+    if (!file.open(path)) {
+      std::cerr << "Failed to map scene image " << path << "\n";
+      return false;
+    }
+    SceneImageInfo info;
+    if (!inspectSceneImage(file.data(), file.size(), rawRes.x, rawRes.y, info)) {
+      std::cerr << "Unrecognized or truncated scene image " << path << "\n";
+      return false;
+    }
+    if (!ensureBuffers_(glm::ivec2(info.width, info.height))) return false;
+
+    const int half = (current_ + 1) % kBuffers;
+    waitBuffer_(half);
+    float* dst = mapped_ ? reinterpret_cast<float*>(mapped_ + size_t(half) * buffer_bytes_)
+                         : (staging_.resize(buffer_bytes_ / sizeof(float)), staging_.data());
+    if (!decodeSceneImage(file.data(), file.size(), info, dst)) {
+      std::cerr << "Failed to decode scene image " << path << "\n";
+      return false;
+    }
+    if (!mapped_) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+      glBufferSubData(GL_PIXEL_UNPACK_BUFFER, GLintptr(half) * GLintptr(buffer_bytes_), GLsizeiptr(buffer_bytes_), dst);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    current_ = half;
+    loaded_  = true;
+    pending_ = true;
+    return true;
+  }
+
+  bool loaded() const  { return loaded_; }   // a staged image exists (the scene comes from files)
+  bool pending() const { return pending_; }  // staged but not yet uploaded
+  glm::ivec2 size() const { return size_; }
+
+  // Copy the staged image into 'sceneTex' (size() texels, any float RGBA format). Repeating it
+  // without a new load() re-uploads the same image, e.g. into a reallocated texture.
+  void upload(GLuint sceneTex) {
+    if (!loaded_) return;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, sceneTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size_.x, size_.y, GL_RGBA, GL_FLOAT,
+                    reinterpret_cast<const void*>(size_t(current_) * buffer_bytes_));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (fences_[current_]) glDeleteSync(fences_[current_]);
+    fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pending_ = false;
+  }
+
+  // Back to generated scenes; keeps the buffers for a later load()
+  void clear() { loaded_ = pending_ = false; }
+
+  void cleanup() {
+    for (GLsync& f : fences_) if (f) { glDeleteSync(f); f = nullptr; }
+    releaseBuffer_();
+    staging_.clear();
+    loaded_ = pending_ = false;
+  }
+
+private:
+  GpuResourceManager resources_;
+  GLuint   pbo_ = 0;
+  uint8_t* mapped_ = nullptr;  // persistent coherent mapping, or null (glBufferSubData)
+  size_t   buffer_bytes_ = 0;  // one half
+  glm::ivec2 size_{0, 0};
+  int      current_ = 0;
+  bool     loaded_ = false, pending_ = false;
+  GLsync   fences_[kBuffers] = {nullptr, nullptr};
+  std::vector<float> staging_;
+
+  bool ensureBuffers_(const glm::ivec2& size) {
+    if (pbo_ && size == size_) return true;
+    for (int i = 0; i < kBuffers; ++i) waitBuffer_(i);
+    releaseBuffer_();
+    size_ = size;
+    buffer_bytes_ = size_t(size.x) * size_t(size.y) * 16u;
+    const GLsizeiptr total = GLsizeiptr(buffer_bytes_) * kBuffers;
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+      const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      resources_.ensureBuffer(pbo_, total, flags);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+      mapped_ = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, total, flags));
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+      resources_.ensureBuffer(pbo_, total);
+    }
+    if (!pbo_) {
+      std::cerr << "Failed to allocate the scene upload buffer.\n";
+      return false;
+    }
+    // A stale half must never be uploaded as the new size
+    loaded_ = pending_ = false;
+    return true;
+  }
+
+  void waitBuffer_(int i) {
+    if (!fences_[i]) return;
+    while (glClientWaitSync(fences_[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fences_[i]);
+    fences_[i] = nullptr;
+  }
+
+  void releaseBuffer_() {
+    if (mapped_) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      mapped_ = nullptr;
+    }
+    resources_.releaseBuffer(pbo_);
+  }
+};
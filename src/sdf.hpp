@@ -0,0 +1,178 @@
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
+// Distance field of the scene's occluders (texels with alpha > 0), built with jump flooding.
+// distanceTex() is R32F: per texel, the distance in pixels from its center to the nearest
+// occupied texel center (0 on occluders, kEmptyDistance if the scene has none).
+// The flood runs the usual log2 passes plus two refinement passes (steps 2 and 1), which
+// removes nearly all of plain JFA's nearest-seed errors; consumers still keep a margin.
+class SceneDistanceField {
+public:
+  static constexpr float kEmptyDistance = 1e30f;
+
+  SceneDistanceField() = default;
+  ~SceneDistanceField() { cleanup(); }
+
+  SceneDistanceField(const SceneDistanceField&) = delete;
+  SceneDistanceField& operator=(const SceneDistanceField&) = delete;
+
+  // Ready once every program is built; Pending while the background compiler is still on them
+  // (call again later), Failed if any did not build
+  ProgramStatus initialize() {
+    if (failed_) return ProgramStatus::Failed;
+    const ProgramStatus status = combineStatus({
+      acquirePipeline(seed_, seedCS_(), "Distance field"),
+      acquirePipeline(flood_, floodCS_(), "Distance field"),
+      acquirePipeline(resolve_, resolveCS_(), "Distance field")});
+    if (status == ProgramStatus::Failed) {
+      std::cerr << "Failed to compile distance field programs.\n";
+      seed_.reset(); flood_.reset(); resolve_.reset();
+      failed_ = true;
+    }
+    if (status == ProgramStatus::Ready) loc_flood_step_ = flood_.uniform("stepSize");
+    return status;
+  }
+
+  // Rebuild from the alpha of 'sceneTex' (any float format, sampled). Leaves the distance
+  // visible to texel fetches.
+  void build(GLuint sceneTex, const glm::ivec2& res) {
+    if (!seed_ || !flood_ || !resolve_) return;
+    resources_.ensureTexture2D(seeds_[0], res.x, res.y, GL_RG32I, GL_NEAREST, GL_NEAREST);
+    resources_.ensureTexture2D(seeds_[1], res.x, res.y, GL_RG32I, GL_NEAREST, GL_NEAREST);
+    resources_.ensureTexture2D(distance_, res.x, res.y, GL_R32F, GL_NEAREST, GL_NEAREST);
+
+    const GLuint gx = GLuint((res.x + 15) / 16), gy = GLuint((res.y + 15) / 16);
+
+    glUseProgram(seed_.program());
+    glActiveTexture(GL_TEXTURE0 + GLuint(seed_.binding("sceneTex")));
+    glBindTexture(GL_TEXTURE_2D, sceneTex);
+    glBindImageTexture(GLuint(seed_.binding("seedOutput")), seeds_[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32I);
+    glDispatchCompute(gx, gy, 1);
+
+    // Steps N/2, N/4, ..., 1, then 2, 1 again
+    int largest = 1;
+    while (largest * 2 < std::max(res.x, res.y)) largest *= 2;
+    passes_ = 0;
+    int src = 0;
+    glUseProgram(flood_.program());
+    const GLuint unitIn = GLuint(flood_.binding("seedInput")), unitOut = GLuint(flood_.binding("seedOutput"));
+    auto pass = [&](int step) {
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+      glUniform1i(loc_flood_step_, step);
+      glActiveTexture(GL_TEXTURE0 + unitIn);
+      glBindTexture(GL_TEXTURE_2D, seeds_[src]);
+      glBindImageTexture(unitOut, seeds_[1 - src], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32I);
+      glDispatchCompute(gx, gy, 1);
+      src = 1 - src;
+      ++passes_;
+    };
+    for (int step = largest; step >= 1; step /= 2) pass(step);
+    pass(2);
+    pass(1);
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    glUseProgram(resolve_.program());
+    glActiveTexture(GL_TEXTURE0 + GLuint(resolve_.binding("seedInput")));
+    glBindTexture(GL_TEXTURE_2D, seeds_[src]);
+    glBindImageTexture(GLuint(resolve_.binding("distanceOutput")), distance_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(gx, gy, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+  }
+
+  GLuint distanceTex() const { return distance_; }
+
+  // Flood passes of the last build (diagnostics)
+  int passes() const { return passes_; }
+
+  void cleanup() {
+    resources_.releaseTexture(seeds_[0]);
+    resources_.releaseTexture(seeds_[1]);
+    resources_.releaseTexture(distance_);
+    seed_.reset(); flood_.reset(); resolve_.reset();
+  }
+
+private:
+  GpuResourceManager resources_;
+  ComputePipeline seed_, flood_, resolve_;
+  GLint  loc_flood_step_ = -1;
+  GLuint seeds_[2] = {0, 0};  // RG32I nearest occupied texel, (-1,-1) if none yet
+  GLuint distance_ = 0;
+  int    passes_ = 0;
+  bool   failed_ = false;
+
+  static const char* seedCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform sampler2D sceneTex;
+layout(binding = 0, rg32i) uniform writeonly iimage2D seedOutput;
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (p.x >= imageSize(seedOutput).x || p.y >= imageSize(seedOutput).y) return;
+  bool occupied = texelFetch(sceneTex, p, 0).a > 0.0;
+  imageStore(seedOutput, p, ivec4(occupied ? p : ivec2(-1), 0, 0));
+}
+)";
+  }
+
+  static const char* floodCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform isampler2D seedInput;
+layout(binding = 0, rg32i) uniform writeonly iimage2D seedOutput;
+uniform int stepSize;
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 size = imageSize(seedOutput);
+  if (p.x >= size.x || p.y >= size.y) return;
+
+  ivec2 best = ivec2(-1);
+  int bestDist2 = 0x7FFFFFFF;
+  for (int dy = -1; dy <= 1; ++dy)
+  for (int dx = -1; dx <= 1; ++dx) {
+    ivec2 q = p + ivec2(dx, dy) * stepSize;
+    if (q.x < 0 || q.y < 0 || q.x >= size.x || q.y >= size.y) continue;
+    ivec2 s = texelFetch(seedInput, q, 0).xy;
+    if (s.x < 0) continue;
+    ivec2 d = s - p;
+    int d2 = d.x * d.x + d.y * d.y;
+    if (d2 < bestDist2) { bestDist2 = d2; best = s; }
+  }
+  imageStore(seedOutput, p, ivec4(best, 0, 0));
+}
+)";
+  }
+
+  static const char* resolveCS_() {
+    return R"(
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(binding = 0) uniform isampler2D seedInput;
+layout(binding = 0, r32f) uniform writeonly image2D distanceOutput;
+
+void main() {
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (p.x >= imageSize(distanceOutput).x || p.y >= imageSize(distanceOutput).y) return;
+  ivec2 s = texelFetch(seedInput, p, 0).xy;
+  float d = s.x < 0 ? 1e30 : length(vec2(s - p));
+  imageStore(distanceOutput, p, vec4(d));
+}
+)";
+  }
+};
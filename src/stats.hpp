@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <cstdint>
 #include <cmath>
 #include <iostream>
@@ -9,6 +10,10 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "resources.hpp"
+#include "program_cache.hpp"
+#include "pipeline.hpp"
+
 // Radial statistics payload used by plots/UI
 struct RadialStats {
   std::vector<float> radii;
@@ -18,90 +23,239 @@ struct RadialStats {
   std::vector<float> ground_truth;
   std::vector<float> stddev_upper;
   std::vector<float> stddev_lower;
+  std::vector<float> stddev_percent;  // stddev / mean in percent (0 where the mean is 0)
+  uint64_t generation = 0;            // stats dispatch this came from (AsyncStatsManager)
 };
 
+// Per-tile radial histogram: each 16x16 workgroup accumulates the (at most TILE_BINS) radii it
+// touches in shared memory and flushes them with one set of global atomics per radius.
+// Sums are 64-bit fixed point stored as (lo, hi) uint pairs, so they cannot overflow at 8K.
+// Luminance is quantized to 2^-20 in a uint (clamped below 4096) and squared exactly with
+// umulExtended, so no fp64 is needed. With RC_SUBGROUP, a subgroup loops over its distinct
+// radii: the lanes matching the first remaining one reduce with subgroupAdd, make a single
+// shared update and retire.
 static inline const char* kRadialStatsCS = R"(
-#version 430
+#ifdef RC_SUBGROUP
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#endif
 layout(local_size_x = 16, local_size_y = 16) in;
 
-// Read the rendered image directly (RGBA32F)
-layout(binding=3, rgba32f) uniform readonly image2D resultImage;
+// Read the rendered image through a sampler, so any float storage format works
+layout(binding=3) uniform sampler2D resultTex;
 
 // Per-radius accumulators (unsized arrays)
 layout(std430, binding=0) buffer CountBuf { uint count[]; };
-layout(std430, binding=1) buffer SumBuf   { uint sumQ[]; };     // fixed-point sum of luminance
-layout(std430, binding=2) buffer SsqBuf   { uint sumsqQ[]; };   // fixed-point sum of squares
+layout(std430, binding=1) buffer SumBuf   { uint sumQ[]; };     // 64-bit fixed-point sum of luminance, (lo, hi) per radius
+layout(std430, binding=2) buffer SsqBuf   { uint sumsqQ[]; };   // same for squares
 
 uniform ivec2 imgSize;
 uniform vec2  center;
 uniform int   maxRadius;
 
-const float SCALE = 1048576.0; // 2^20 fixed-point scale
+const float kMaxLum = 4095.0;  // keeps lum * 2^20 within a uint
 
-void main() {
-  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
-  if (p.x >= imgSize.x || p.y >= imgSize.y) return;
+#define TILE_BINS 32  // a 16x16 tile spans fewer radii than its diagonal (< 22 px) plus one
 
-  vec4 c = imageLoad(resultImage, p);
-  float lum = 0.2126*c.r + 0.7152*c.g + 0.0722*c.b;
+shared uint tileBase;
+shared uint tileCount[TILE_BINS];
+shared uint tileSum[2 * TILE_BINS];
+shared uint tileSsq[2 * TILE_BINS];
 
-  vec2 fp = vec2(p) + vec2(0.5);
-  int r = int(length(fp - center));
-  if (r < 0 || r > maxRadius) return;
+uint quantize(float v) { return uint(round(clamp(v, 0.0, kMaxLum) * 1048576.0)); }
 
-  atomicAdd(count[r], 1u);
-  uint q  = uint(round(lum * SCALE));
-  uint qq = uint(round(lum * lum * SCALE));
-  atomicAdd(sumQ[r], q);
-  atomicAdd(sumsqQ[r], qq);
+// q^2 / 2^20, rounded, as (lo, hi)
+uvec2 square20(uint q) {
+  uint hi, lo, carry;
+  umulExtended(q, q, hi, lo);
+  lo = uaddCarry(lo, 1u << 19, carry);
+  hi += carry;
+  return uvec2((lo >> 20) | (hi << 12), hi >> 20);
+}
+
+#ifdef RC_SUBGROUP
+// 64-bit value from sums of its 16-bit halves of the low word and of the high word
+uvec2 join16(uint lo16, uint hi16, uint hi) {
+  uint carry;
+  uint lo = uaddCarry(lo16, hi16 << 16, carry);
+  return uvec2(lo, hi + (hi16 >> 16) + carry);
+}
+#endif
+
+// 64-bit adds as two 32-bit atomics; the carry comes from the low word's previous value
+void addTile(uint bin, uvec2 s, uvec2 ss) {
+  uint old = atomicAdd(tileSum[2u * bin], s.x);
+  uint hi  = s.y + (old + s.x < old ? 1u : 0u);
+  if (hi != 0u) atomicAdd(tileSum[2u * bin + 1u], hi);
+  old = atomicAdd(tileSsq[2u * bin], ss.x);
+  hi  = ss.y + (old + ss.x < old ? 1u : 0u);
+  if (hi != 0u) atomicAdd(tileSsq[2u * bin + 1u], hi);
 }
-)";
 
-static inline GLuint compileCS(const char* src) {
-  GLuint sh = glCreateShader(GL_COMPUTE_SHADER);
-  glShaderSource(sh, 1, &src, nullptr);
-  glCompileShader(sh);
-  GLint ok = GL_FALSE;
-  glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
-  if (!ok) {
-    char log[4096];
-    glGetShaderInfoLog(sh, sizeof(log), nullptr, log);
-    std::cerr << "Compute shader compile error:\n" << log << std::endl;
+void addGlobal(uint r, uvec2 s, uvec2 ss) {
+  uint old = atomicAdd(sumQ[2u * r], s.x);
+  uint hi  = s.y + (old + s.x < old ? 1u : 0u);
+  if (hi != 0u) atomicAdd(sumQ[2u * r + 1u], hi);
+  old = atomicAdd(sumsqQ[2u * r], ss.x);
+  hi  = ss.y + (old + ss.x < old ? 1u : 0u);
+  if (hi != 0u) atomicAdd(sumsqQ[2u * r + 1u], hi);
+}
+
+void main() {
+  uint li = gl_LocalInvocationIndex;
+  if (li == 0u) tileBase = 0xFFFFFFFFu;
+  if (li < uint(TILE_BINS)) {
+    tileCount[li] = 0u;
+    tileSum[2u * li] = 0u; tileSum[2u * li + 1u] = 0u;
+    tileSsq[2u * li] = 0u; tileSsq[2u * li + 1u] = 0u;
   }
-  GLuint prog = glCreateProgram();
-  glAttachShader(prog, sh);
-  glLinkProgram(prog);
-  glDeleteShader(sh);
-  glGetProgramiv(prog, GL_LINK_STATUS, &ok);
-  if (!ok) {
-    char log[4096];
-    glGetProgramInfoLog(prog, sizeof(log), nullptr, log);
-    std::cerr << "Compute shader link error:\n" << log << std::endl;
+  barrier();
+
+  ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  int r = -1;
+  float lum = 0.0;
+  if (p.x < imgSize.x && p.y < imgSize.y) {
+    vec4 c = texelFetch(resultTex, p, 0);
+    lum = 0.2126*c.r + 0.7152*c.g + 0.0722*c.b;
+    vec2 fp = vec2(p) + vec2(0.5);
+    r = int(length(fp - center));
+    if (r > maxRadius) r = -1;
+  }
+  if (r >= 0) atomicMin(tileBase, uint(r));
+  barrier();
+
+  if (r >= 0) {
+    uint  bin = uint(r) - tileBase;
+    uint  q   = quantize(lum);
+    uvec2 sq  = square20(q);
+#ifdef RC_SUBGROUP
+    // Split into 16-bit pieces so the subgroup sums cannot wrap
+    for (;;) {
+      if (subgroupBroadcastFirst(bin) == bin) {
+        uvec3 s  = subgroupAdd(uvec3(1u, q & 0xFFFFu, q >> 16));
+        uvec3 ss = subgroupAdd(uvec3(sq.x & 0xFFFFu, sq.x >> 16, sq.y));
+        if (subgroupElect()) {
+          atomicAdd(tileCount[bin], s.x);
+          addTile(bin, join16(s.y, s.z, 0u), join16(ss.x, ss.y, ss.z));
+        }
+        break;
+      }
+    }
+#else
+    atomicAdd(tileCount[bin], 1u);
+    addTile(bin, uvec2(q, 0u), sq);
+#endif
+  }
+  barrier();
+
+  // Flush: one invocation per touched radius
+  if (li < uint(TILE_BINS) && tileCount[li] != 0u) {
+    uint gr = tileBase + li;
+    atomicAdd(count[gr], tileCount[li]);
+    addGlobal(gr, uvec2(tileSum[2u * li], tileSum[2u * li + 1u]), uvec2(tileSsq[2u * li], tileSsq[2u * li + 1u]));
+  }
+}
+)";
+
+#ifndef GL_SUBGROUP_SUPPORTED_STAGES_KHR
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR   0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+#endif
+
+// KHR_shader_subgroup with ballot and arithmetic operations in compute shaders
+static inline bool radialStatsSubgroupsSupported() {
+  GLint n = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+  bool found = false;
+  for (GLint i = 0; i < n && !found; ++i) {
+    const char* e = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+    found = e && std::string(e) == "GL_KHR_shader_subgroup";
   }
-  return prog;
+  if (!found) return false;
+  GLint stages = 0, features = 0;
+  glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+  glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+  const GLint kArithmetic = 0x4, kBallot = 0x8;
+  return (stages & GL_COMPUTE_SHADER_BIT) && (features & kArithmetic) && (features & kBallot);
 }
 
 struct GPUBins {
-  std::vector<uint32_t> count, sumQ, sumsqQ;
+  std::vector<uint32_t> count;
+  std::vector<uint64_t> sumQ, sumsqQ;  // fixed point, 2^20 per unit
+  uint64_t generation = 0;
+
+  // Unpack the shader's (lo, hi) pairs
+  static void widen(const uint32_t* pairs, size_t bins, std::vector<uint64_t>& out) {
+    out.resize(bins);
+    for (size_t i = 0; i < bins; ++i) out[i] = uint64_t(pairs[2 * i]) | (uint64_t(pairs[2 * i + 1]) << 32);
+  }
+};
+
+// kRadialStatsCS with its uniform locations and bindings reflected once at link time.
+struct RadialStatsProgram {
+  ComputePipeline pipeline;
+  GLint  loc_img_size   = -1;
+  GLint  loc_center     = -1;
+  GLint  loc_max_radius = -1;
+  GLuint unit_tex     = 3;
+  GLuint bind_count   = 0;
+  GLuint bind_sum     = 1;
+  GLuint bind_sumsq   = 2;
+  bool   subgroups    = false;  // built with the subgroup pre-reduction
+  bool   subgroups_failed = false;
+  bool   failed       = false;
+
+  // False while the background compiler is still building it (call again later) or if it
+  // failed to build; 'wait' blocks on the build instead
+  bool ensure(bool wait = false) {
+    if (pipeline) return true;
+    if (failed) return false;
+    // Subgroup variant first; a driver that advertises but fails to build it gets the plain one
+    const std::string plain = std::string("#version 430\n") + kRadialStatsCS;
+    const std::string subgroup = std::string("#version 430\n#define RC_SUBGROUP\n") + kRadialStatsCS;
+    ProgramStatus status = ProgramStatus::Failed;
+    if (!subgroups_failed && radialStatsSubgroupsSupported()) {
+      status = acquirePipeline(pipeline, subgroup, "Radial stats", wait);
+      if (status == ProgramStatus::Pending) return false;
+      subgroups_failed = status == ProgramStatus::Failed;
+    }
+    subgroups = status == ProgramStatus::Ready;
+    if (!subgroups) {
+      status = acquirePipeline(pipeline, plain, "Radial stats", wait);
+      if (status == ProgramStatus::Pending) return false;
+      failed = status == ProgramStatus::Failed;
+      if (failed) return false;
+    }
+    loc_img_size   = pipeline.uniform("imgSize");
+    loc_center     = pipeline.uniform("center");
+    loc_max_radius = pipeline.uniform("maxRadius");
+    unit_tex       = GLuint(pipeline.binding("resultTex"));
+    bind_count     = GLuint(pipeline.binding("CountBuf"));
+    bind_sum       = GLuint(pipeline.binding("SumBuf"));
+    bind_sumsq     = GLuint(pipeline.binding("SsqBuf"));
+    return true;
+  }
 };
 
 // Launch-only variant for non-blocking pipelines (no readback here).
 // Callers can use a fence or a separate read-back pass on the next frame.
+// Binds go through 'state', so back-to-back dispatches skip the ones already in place; the
+// caller invalidates it whenever other code may have touched the bindings.
 static inline void dispatch_radial_bins_compute(GLuint tex, int W, int H,
                                                 GLuint ssbo_count, GLuint ssbo_sumQ, GLuint ssbo_sumsqQ,
-                                                GLuint program /* optional precompiled */) {
+                                                const RadialStatsProgram& prog, GLStateCache& state) {
   const int max_radius = int(glm::length(glm::vec2(float(W), float(H)) * 0.5f));
-  GLuint prog = program ? program : compileCS(kRadialStatsCS);
 
-  glUseProgram(prog);
-  glUniform2i(glGetUniformLocation(prog, "imgSize"), W, H);
-  glUniform2f(glGetUniformLocation(prog, "center"), 0.5f * float(W), 0.5f * float(H));
-  glUniform1i(glGetUniformLocation(prog, "maxRadius"), max_radius);
+  state.useProgram(prog.pipeline.program());
+  glUniform2i(prog.loc_img_size, W, H);
+  glUniform2f(prog.loc_center, 0.5f * float(W), 0.5f * float(H));
+  glUniform1i(prog.loc_max_radius, max_radius);
 
-  glBindImageTexture(3, tex, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, ssbo_count);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo_sumQ);
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, ssbo_sumsqQ);
+  state.bindTexture(prog.unit_tex, tex);
+  state.bindStorageBuffer(prog.bind_count, ssbo_count);
+  state.bindStorageBuffer(prog.bind_sum,   ssbo_sumQ);
+  state.bindStorageBuffer(prog.bind_sumsq, ssbo_sumsqQ);
 
   GLuint gx = (GLuint)((W + 15) / 16);
   GLuint gy = (GLuint)((H + 15) / 16);
@@ -109,94 +263,209 @@ static inline void dispatch_radial_bins_compute(GLuint tex, int W, int H,
   glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
+// Convert GPU bins to RadialStats in place: vectors keep their capacity, and the ground-truth
+// curve (which only depends on the radius range) is only rebuilt when that range changes.
+static inline void convert_bins_to_stats(const GPUBins& bins, RadialStats& out) {
+  const size_t n_bins = bins.count.size();
+  const double SCALE = 1048576.0;
+
+  out.radii.resize(n_bins);
+  out.mean.resize(n_bins);
+  out.stddev.resize(n_bins);
+  out.count.resize(n_bins);
+  out.stddev_upper.resize(n_bins);
+  out.stddev_lower.resize(n_bins);
+  out.stddev_percent.resize(n_bins);
+
+  for (size_t r = 0; r < n_bins; ++r) {
+    out.radii[r] = float(r);
+    const uint32_t n = bins.count[r];
+    out.count[r] = int(n);
+    // Double throughout: E[x^2] - E[x]^2 cancels badly in float when the spread is small
+    float mu = 0.0f, sd = 0.0f;
+    if (n > 0u) {
+      const double s  = double(bins.sumQ[r]) / SCALE;
+      const double ss = double(bins.sumsqQ[r]) / SCALE;
+      const double m  = s / double(n);
+      mu = float(m);
+      sd = float(std::sqrt(std::max(ss / double(n) - m * m, 0.0)));
+    }
+    out.mean[r] = mu;
+    out.stddev[r] = sd;
+    out.stddev_upper[r] = mu + sd;
+    out.stddev_lower[r] = std::max(mu - sd, 0.0f);
+    out.stddev_percent[r] = mu != 0.0f ? sd / mu * 100.0f : 0.0f;
+  }
+
+  // Ground truth curve (plateau then inverse-square)
+  if (out.ground_truth.size() != n_bins) {
+    out.ground_truth.resize(n_bins);
+    const float disk_radius = 15.0f;
+    const float peak = 1.0f;
+    for (size_t r = 0; r < n_bins; ++r) {
+      if (int(r) <= int(disk_radius)) {
+        out.ground_truth[r] = peak;
+      } else {
+        out.ground_truth[r] = peak * disk_radius * disk_radius / (float(r) * float(r) + 1e-3f);
+      }
+    }
+  }
+  out.generation = bins.generation;
+}
+
+// Radial stats without pipeline stalls: each dispatch accumulates into its own slot of an
+// N-deep ring and is fenced. try_read_stats only consumes a slot whose fence has signalled,
+// reading it through a persistently mapped coherent buffer, and does nothing at all when no
+// dispatch happened since the last read.
 class AsyncStatsManager {
+public:
+  static constexpr int kRingSize = 3;
+
 private:
-  GLuint ssbo_buffers_[6] = {0}; // Double-buffered: [count0, sum0, sumsq0, count1, sum1, sumsq1]
-  GLuint stats_program_ = 0;
-  int active_write_buffer_ = 0;
+  struct Slot {
+    GLuint buffers[3] = {0, 0, 0};                         // count, sumQ, sumsqQ
+    const uint32_t* mapped[3] = {nullptr, nullptr, nullptr};  // null -> glGetBufferSubData
+    GLsync   fence = nullptr;
+    uint64_t generation = 0;                               // dispatch that filled it, 0 = none
+  };
+
+  Slot slots_[kRingSize];
+  RadialStatsProgram stats_program_;
+  GLStateCache       state_;
+  GpuResourceManager resources_;
+  int next_slot_ = 0;
+  uint64_t dispatched_ = 0;  // generation of the newest dispatch
+  uint64_t consumed_ = 0;    // generation of the last result handed out
   int max_radius_ = 0;
   bool initialized_ = false;
+  GPUBins bins_;                      // try_read_stats scratch
+  std::vector<uint32_t> staging_[3];  // readback without persistent mapping
   
 public:
-  void init(int max_radius) {
-    if (initialized_ && max_radius_ == max_radius) return;
+  // 'wait' blocks on the stats program build; without it dispatches are skipped until the
+  // background compiler has it
+  void init(int max_radius, bool wait = false) {
+    if (initialized_ && max_radius_ == max_radius) {
+      stats_program_.ensure(wait);
+      return;
+    }
     
     cleanup();
     max_radius_ = max_radius;
-    const size_t bins = max_radius + 1;
-    
-    glGenBuffers(6, ssbo_buffers_);
-    std::vector<uint32_t> zero(bins, 0u);
+    // Counts are one uint per radius, sums a (lo, hi) pair
+    const size_t bins = size_t(max_radius + 1);
+    const GLsizeiptr bytes[3] = {GLsizeiptr(bins * 4u), GLsizeiptr(bins * 8u), GLsizeiptr(bins * 8u)};
+    const bool persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
     
-    for (int i = 0; i < 6; ++i) {
-      glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_buffers_[i]);
-      glBufferData(GL_SHADER_STORAGE_BUFFER, bins * sizeof(uint32_t), 
-                  zero.data(), GL_DYNAMIC_DRAW);
+    for (Slot& slot : slots_) {
+      for (int i = 0; i < 3; ++i) {
+        resources_.ensureBuffer(slot.buffers[i], bytes[i], persistent ? flags : GL_DYNAMIC_STORAGE_BIT);
+        if (persistent) {
+          glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffers[i]);
+          slot.mapped[i] = static_cast<const uint32_t*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, bytes[i], flags));
+        }
+      }
     }
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     
-    if (!stats_program_) {
-      stats_program_ = compileCS(kRadialStatsCS);
-    }
+    stats_program_.ensure(wait);
     initialized_ = true;
   }
   
-  // Launch async stats computation (no readback)
-  void dispatch_async(GLuint tex, int W, int H) {
-    if (!initialized_) return;
-    
-    int write_base = active_write_buffer_ * 3;
-    
-    // Clear current write buffers
-    const size_t bins = max_radius_ + 1;
-    std::vector<uint32_t> zero(bins, 0u);
-    for (int i = 0; i < 3; ++i) {
-      glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_buffers_[write_base + i]);
-      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), zero.data());
+  // Launch async stats computation (no readback). Reuses the oldest slot; an unread result
+  // in it is superseded by this one. Skipped while the program is still being built.
+  // 'state' is the caller's binding cache when it dispatches between its own cached passes;
+  // by default the manager's own one is used, invalidated per call since the frame loop
+  // changes bindings between dispatches.
+  void dispatch_async(GLuint tex, int W, int H, GLStateCache* state = nullptr) {
+    if (!initialized_ || !stats_program_.ensure()) return;
+    if (!state) {
+      state_.invalidate();
+      state = &state_;
     }
     
-    dispatch_radial_bins_compute(tex, W, H, 
-      ssbo_buffers_[write_base], ssbo_buffers_[write_base + 1], ssbo_buffers_[write_base + 2], 
-      stats_program_);
+    Slot& slot = slots_[next_slot_];
+    next_slot_ = (next_slot_ + 1) % kRingSize;
+    if (slot.fence) { glDeleteSync(slot.fence); slot.fence = nullptr; }
     
-    // Let next frame read the just-written buffer
-    active_write_buffer_ = 1 - active_write_buffer_;
+    // Clear the slot's accumulators on the GPU (ordered after any earlier use of them)
+    for (GLuint buf : slot.buffers) resources_.clearBuffer(buf);
+    
+    dispatch_radial_bins_compute(tex, W, H, slot.buffers[0], slot.buffers[1], slot.buffers[2], stats_program_, *state);
+    // Shader writes to the persistent mappings must be visible once the fence signals
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.generation = ++dispatched_;
   }
   
-  // Try to read previous frame's results (non-blocking)
-  bool try_read_stats(RadialStats& out_stats, int W, int H) {
-    if (!initialized_) return false;
+  // Read the raw bins of the newest finished dispatch not read yet (non-blocking). Returns
+  // false when there is none, i.e. nothing new was dispatched or the GPU has not finished it.
+  // Reuses the capacity of 'out', so steady-state reads do not allocate.
+  bool try_read_bins(GPUBins& out) {
+    if (!initialized_ || consumed_ == dispatched_) return false;
     
-    int read_base = (1 - active_write_buffer_) * 3;
-    const size_t bins = max_radius_ + 1;
-    
-    // Read previous frame's compute results
-    GPUBins bins_data;
-    bins_data.count.resize(bins);
-    bins_data.sumQ.resize(bins);
-    bins_data.sumsqQ.resize(bins);
+    Slot* ready = nullptr;
+    for (Slot& slot : slots_) {
+      if (!slot.fence || slot.generation <= consumed_) continue;
+      if (ready && slot.generation < ready->generation) continue;
+      const GLenum r = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+      if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED) ready = &slot;
+    }
+    if (!ready) return false;
     
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_buffers_[read_base]);
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), bins_data.count.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_buffers_[read_base + 1]);
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), bins_data.sumQ.data());
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo_buffers_[read_base + 2]);
-    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), bins_data.sumsqQ.data());
+    const size_t bins = size_t(max_radius_ + 1);
+    const uint32_t* src[3];
+    for (int i = 0; i < 3; ++i) {
+      const size_t n = i == 0 ? bins : 2 * bins;
+      if (ready->mapped[i]) {
+        src[i] = ready->mapped[i];
+      } else {
+        staging_[i].resize(n);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, ready->buffers[i]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(n * sizeof(uint32_t)), staging_[i].data());
+        src[i] = staging_[i].data();
+      }
+    }
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    
-    // Convert to RadialStats
-    out_stats = convert_bins_to_stats(bins_data, W, H);
+    out.count.assign(src[0], src[0] + bins);
+    GPUBins::widen(src[1], bins, out.sumQ);
+    GPUBins::widen(src[2], bins, out.sumsqQ);
+    out.generation = ready->generation;
+    consumed_ = ready->generation;
+    return true;
+  }
+  
+  // try_read_bins followed by the conversion on the calling thread
+  bool try_read_stats(RadialStats& out_stats) {
+    if (!try_read_bins(bins_)) return false;
+    convert_bins_to_stats(bins_, out_stats);
     return true;
   }
   
+  // Generation (1, 2, ...) of the result last returned by try_read_stats; 0 before the first
+  uint64_t generation() const { return consumed_; }
+  // Generation of the newest dispatch
+  uint64_t dispatched_generation() const { return dispatched_; }
+  
   void cleanup() {
     if (initialized_) {
-      glDeleteBuffers(6, ssbo_buffers_);
-      memset(ssbo_buffers_, 0, sizeof(ssbo_buffers_));
-      if (stats_program_) {
-        glDeleteProgram(stats_program_);
-        stats_program_ = 0;
+      for (Slot& slot : slots_) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        for (int i = 0; i < 3; ++i) {
+          if (slot.mapped[i]) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffers[i]);
+            glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+          }
+          resources_.releaseBuffer(slot.buffers[i]);
+        }
+        slot = Slot{};
       }
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      stats_program_.pipeline.reset();
+      next_slot_ = 0;
+      consumed_ = dispatched_;  // generations stay monotonic across re-inits
       initialized_ = false;
     }
   }
@@ -204,94 +473,4 @@ public:
   ~AsyncStatsManager() {
     cleanup();
   }
-
-private:
-  // Convert GPU bins to RadialStats structure
-  RadialStats convert_bins_to_stats(const GPUBins& bins, int W, int H) {
-    const int max_radius = int(glm::length(glm::vec2(float(W), float(H)) * 0.5f));
-    const float SCALE = 1048576.0f;
-
-    std::vector<float> radii;
-    std::vector<float> mean(max_radius + 1, 0.0f);
-    std::vector<float> stddev(max_radius + 1, 0.0f);
-    std::vector<float> stddev_upper;
-    std::vector<float> stddev_lower;
-    std::vector<int>   count(max_radius + 1, 0);
-    std::vector<float> ground_truth(max_radius + 1, 0.0f);
-
-    radii.reserve(max_radius + 1);
-    stddev_upper.reserve(max_radius + 1);
-    stddev_lower.reserve(max_radius + 1);
-
-    for (int r = 0; r <= max_radius; ++r) {
-      radii.push_back(float(r));
-      uint32_t n  = bins.count[size_t(r)];
-      count[r] = int(n);
-      if (n > 0u) {
-        float s  = float(bins.sumQ[size_t(r)]) / SCALE;
-        float ss = float(bins.sumsqQ[size_t(r)]) / SCALE;
-        float mu = s / float(n);
-        float var = std::max(ss / float(n) - mu * mu, 0.0f);
-        mean[r] = mu;
-        stddev[r] = std::sqrt(var);
-      }
-      stddev_upper.push_back(mean[r] + stddev[r]);
-      stddev_lower.push_back(std::max(mean[r] - stddev[r], 0.0f));
-    }
-
-    // Ground truth curve (plateau then inverse-square)
-    float disk_radius = 15.0f;
-    float peak = 1.0f;
-    for (int r = 0; r <= max_radius; ++r) {
-      if (r <= int(disk_radius)) {
-        ground_truth[r] = peak;
-      } else {
-        ground_truth[r] = peak * disk_radius * disk_radius / (float(r) * float(r) + 1e-3f);
-      }
-    }
-
-    return RadialStats{radii, mean, stddev, count, ground_truth, stddev_upper, stddev_lower};
-  }
 };
-
-// Legacy blocking API - kept for backward compatibility but not recommended for use
-static inline GPUBins compute_radial_bins_gpu(GLuint tex, int W, int H) {
-  const int max_radius = int(glm::length(glm::vec2(float(W), float(H)) * 0.5f));
-  const size_t bins = size_t(max_radius + 1);
-
-  static GLuint prog = 0;
-  if (prog == 0) {
-    prog = compileCS(kRadialStatsCS);
-  }
-
-  // SSBOs
-  GLuint ssbo[3] = {0, 0, 0};
-  glGenBuffers(3, ssbo);
-  std::vector<uint32_t> zero(bins, 0u);
-  for (int i = 0; i < 3; ++i) {
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[i]);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, bins * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), zero.data());
-  }
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-
-  // Dispatch compute
-  dispatch_radial_bins_compute(tex, W, H, ssbo[0], ssbo[1], ssbo[2], prog);
-
-  // Read back small SSBOs
-  GPUBins out;
-  out.count.resize(bins);
-  out.sumQ.resize(bins);
-  out.sumsqQ.resize(bins);
-
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[0]);
-  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), out.count.data());
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[1]);
-  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), out.sumQ.data());
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo[2]);
-  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bins * sizeof(uint32_t), out.sumsqQ.data());
-  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-
-  glDeleteBuffers(3, ssbo);
-  return out;
-}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include "stats.hpp"
+
+// Single-producer/single-consumer triple buffer. The writer fills writeBuffer() and publishes
+// it; the reader calls update() to swap in the newest published buffer, if any, and reads
+// readBuffer(). Neither side ever waits; buffers are reused, so nothing is allocated once
+// every slot has grown to its steady-state size.
+template <typename T>
+class TripleBuffer {
+public:
+  T& writeBuffer() { return slots_[back_]; }
+
+  void publish() {
+    back_ = uint8_t(middle_.exchange(uint8_t(back_ | kFresh), std::memory_order_acq_rel) & kIndex);
+  }
+
+  // True if a newer buffer was swapped in
+  bool update() {
+    if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+    front_ = uint8_t(middle_.exchange(front_, std::memory_order_acq_rel) & kIndex);
+    return true;
+  }
+
+  const T& readBuffer() const { return slots_[front_]; }
+
+private:
+  static constexpr uint8_t kIndex = 3, kFresh = 4;
+  T slots_[3];
+  uint8_t back_ = 0;                 // writer only
+  uint8_t front_ = 1;                // reader only
+  std::atomic<uint8_t> middle_{2};   // last published (or initial) slot, plus kFresh
+};
+
+// Runs convert_bins_to_stats off the render thread.
+// Render thread: AsyncStatsManager::try_read_bins(worker.input()), then worker.submit().
+// UI: worker.latest() is the newest finished RadialStats; it never blocks or allocates.
+class RadialStatsWorker {
+public:
+  RadialStatsWorker() = default;
+  ~RadialStatsWorker() { stop(); }
+
+  RadialStatsWorker(const RadialStatsWorker&) = delete;
+  RadialStatsWorker& operator=(const RadialStatsWorker&) = delete;
+
+  void start() {
+    if (thread_.joinable()) return;
+    stop_.store(false);
+    thread_ = std::thread([this] { loop_(); });
+  }
+
+  void stop() {
+    if (!thread_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      stop_.store(true);
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  // Bins buffer to fill before submit(); owned by the render thread until then
+  GPUBins& input() { return input_.writeBuffer(); }
+
+  // Hand input() to the worker; a submission it has not picked up yet is superseded
+  void submit() {
+    input_.publish();
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      pending_.store(true, std::memory_order_release);
+    }
+    wake_.notify_one();
+  }
+
+  // Newest converted stats (empty before the first); only call from one (UI) thread
+  const RadialStats& latest() {
+    output_.update();
+    return output_.readBuffer();
+  }
+
+private:
+  TripleBuffer<GPUBins> input_;
+  TripleBuffer<RadialStats> output_;
+  std::thread thread_;
+  std::atomic<bool> stop_{false}, pending_{false};
+  std::mutex wake_mutex_;  // guards the wake-up flags; held only for a store or the wait
+  std::condition_variable wake_;
+
+  void loop_() {
+    while (!stop_.load()) {
+      if (input_.update()) {
+        convert_bins_to_stats(input_.readBuffer(), output_.writeBuffer());
+        output_.publish();
+        continue;
+      }
+      // Flags are set under wake_mutex_, so no notify is lost between the check and the wait
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_.wait(lock, [this] { return stop_.load() || pending_.exchange(false, std::memory_order_acquire); });
+    }
+  }
+};
@@ -3,49 +3,28 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <vector>
+#include <cstdint>
 
-// Create or resize a 2D texture with specified parameters.
-inline void ensureTexture2D(GLuint& tex,
-                            int width,
-                            int height,
-                            GLint internalFormat = GL_RGBA32F,
-                            GLint minFilter = GL_NEAREST,
-                            GLint magFilter = GL_NEAREST,
-                            GLint wrapS = GL_CLAMP_TO_EDGE,
-                            GLint wrapT = GL_CLAMP_TO_EDGE) {
-  if (tex != 0) {
-    GLint w = 0, h = 0, fmt = 0;
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
-    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &fmt);
-    if (w == width && h == height && fmt == internalFormat) {
-      // Keep parameters in sync
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
-      return;
-    }
-    glDeleteTextures(1, &tex);
-    tex = 0;
-  }
+// Size/format tracking, immutable storage and GPU-side clears live in resources.hpp
+// (GpuResourceManager); the helpers here are stateless.
 
-  glGenTextures(1, &tex);
+// Blocking readback of level 0 as tightly packed RGBA32F (row 0 first).
+// Stalls until the GPU is done writing 'tex'; intended for validation/tools, not the frame loop.
+inline void readTexture2D(GLuint tex, int width, int height, std::vector<float>& out) {
+  out.assign(static_cast<size_t>(width) * static_cast<size_t>(height) * 4u, 0.0f);
+  if (tex == 0 || width <= 0 || height <= 0) return;
   glBindTexture(GL_TEXTURE_2D, tex);
-  glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, out.data());
 }
 
-// Clear a 2D texture to zero using glTexSubImage2D (portable without requiring GL 4.4 glClearTexImage).
-inline void clearTexture2D(GLuint tex, int width, int height, GLenum format = GL_RGBA, GLenum type = GL_FLOAT) {
+// Blocking readback of level 0 as tightly packed RGBA8 (row 0 first).
+inline void readTexture2D(GLuint tex, int width, int height, std::vector<uint8_t>& out) {
+  out.assign(static_cast<size_t>(width) * static_cast<size_t>(height) * 4u, 0u);
   if (tex == 0 || width <= 0 || height <= 0) return;
-  std::vector<float> zeros(static_cast<size_t>(width) * static_cast<size_t>(height) * 4u, 0.0f);
   glBindTexture(GL_TEXTURE_2D, tex);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, zeros.data());
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
 }
 
 // Bind a texture to a texture unit for sampling (sampler2D).
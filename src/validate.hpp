@@ -0,0 +1,192 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "texture.hpp"
+#include "rc.hpp"
+#include "rc_cpu.hpp"
+#include "stats.hpp"
+#include "metrics.hpp"
+
+// Per-channel comparison of two RGBA32F images of identical size (first 'channels' channels).
+struct ImageDiff {
+  double max_abs    = 0.0;  // largest absolute channel difference
+  double rmse       = 0.0;  // root mean square over all channels
+  size_t mismatches = 0;    // texels with any channel above tolerance
+  int    worst_x    = -1;   // texel holding max_abs
+  int    worst_y    = -1;
+  bool   size_match = true;
+
+  bool passed() const { return size_match && mismatches == 0; }
+};
+
+// A channel mismatches when it is off by more than 'tolerance' + 'relTolerance' * |b|.
+inline ImageDiff diffRGBA32F(const std::vector<float>& a,
+                             const std::vector<float>& b,
+                             int width, int height,
+                             float tolerance,
+                             int channels = 4,
+                             float relTolerance = 0.0f) {
+  ImageDiff d;
+  const size_t texels = size_t(width) * size_t(height);
+  if (a.size() != texels * 4u || b.size() != texels * 4u) {
+    d.size_match = false;
+    return d;
+  }
+
+  double sumsq = 0.0;
+  for (size_t t = 0; t < texels; ++t) {
+    bool bad = false;
+    for (size_t c = 0; c < size_t(channels); ++c) {
+      const double e = std::abs(double(a[t * 4 + c]) - double(b[t * 4 + c]));
+      // NaN on either side counts as a mismatch
+      if (!(e <= tolerance + relTolerance * std::abs(double(b[t * 4 + c])))) bad = true;
+      if (e > d.max_abs) {
+        d.max_abs = e;
+        d.worst_x = int(t % size_t(width));
+        d.worst_y = int(t / size_t(width));
+      }
+      sumsq += e * e;
+    }
+    if (bad) ++d.mismatches;
+  }
+  d.rmse = texels ? std::sqrt(sumsq / double(texels * size_t(channels))) : 0.0;
+  return d;
+}
+
+// Runs the same configuration through the GPU and CPU pipelines and diffs the linear results.
+// Blocks on the GPU readback; use from tools/CI, not from the frame loop.
+// 'gpu' must be initialized on the current context.
+inline ImageDiff validate_gpu_against_cpu(RCGPURenderer& gpu,
+                                          int baseProbeSize,
+                                          float baseIntervalLength,
+                                          int numCascades,
+                                          const glm::ivec2& resolution,
+                                          float tolerance = 1e-3f,
+                                          unsigned numThreads = 0) {
+  gpu.run_full_rc(baseProbeSize, baseIntervalLength, numCascades, resolution);
+  std::vector<float> gpuResult;
+  readTexture2D(gpu.resultTex(), resolution.x, resolution.y, gpuResult);
+
+  RCCPURenderer cpu(numThreads);
+  cpu.run_full_rc(baseProbeSize, baseIntervalLength, numCascades, resolution);
+
+  // Split storage formats keep transmittance out of the result texture; compare radiance only
+  const bool split = rcStorageFormatInfo(gpu.activeStorageFormat()).transmittance != 0;
+  return diffRGBA32F(gpuResult, cpu.result().texels, resolution.x, resolution.y, tolerance, split ? 3 : 4);
+}
+
+// Difference of per-radius mean luminance between two radial-stats results.
+struct RadialStatsError {
+  double max_abs = 0.0;  // largest |mean - ref mean| over populated radii
+  double rms     = 0.0;
+  double max_rel = 0.0;  // largest relative error where the reference mean is above 1e-4
+  int    bins    = 0;
+};
+
+inline RadialStatsError diffRadialStats(const RadialStats& test, const RadialStats& ref) {
+  RadialStatsError e;
+  const size_t n = std::min(test.mean.size(), ref.mean.size());
+  double sumsq = 0.0;
+  for (size_t r = 0; r < n; ++r) {
+    if (ref.count[r] == 0) continue;
+    const double d = std::abs(double(test.mean[r]) - double(ref.mean[r]));
+    e.max_abs = std::max(e.max_abs, d);
+    if (ref.mean[r] > 1e-4f) e.max_rel = std::max(e.max_rel, d / double(ref.mean[r]));
+    sumsq += d * d;
+    ++e.bins;
+  }
+  e.rms = e.bins ? std::sqrt(sumsq / double(e.bins)) : 0.0;
+  return e;
+}
+
+// Radial stats of one full run, read back synchronously (the stats program is built blocking).
+// False if the run was skipped (its programs are still being built) or the stats program is
+// unavailable.
+inline bool radial_stats_of_run(RCGPURenderer& gpu, AsyncStatsManager& stats,
+                                int baseProbeSize, float baseIntervalLength, int numCascades,
+                                const glm::ivec2& resolution, RadialStats& out) {
+  gpu.run_full_rc(baseProbeSize, baseIntervalLength, numCascades, resolution);
+  if (gpu.programsPending()) return false;
+  stats.init(int(glm::length(glm::vec2(resolution) * 0.5f)), /*wait*/true);
+  stats.dispatch_async(gpu.resultTex(), resolution.x, resolution.y);
+  glFinish();
+  return stats.try_read_stats(out);
+}
+
+// Error of the renderer's current storage format and step schedule against the reference
+// (RGBA32F, reference schedule), measured on the radial luminance profile. Runs the
+// configuration both ways (each a full reallocation and recompute) and restores the current
+// settings afterwards. False (leaving 'out' alone) if either profile could not be measured.
+inline bool approximation_error(RCGPURenderer& gpu,
+                                int baseProbeSize,
+                                float baseIntervalLength,
+                                int numCascades,
+                                const glm::ivec2& resolution,
+                                RadialStatsError& out) {
+  AsyncStatsManager stats;
+  RadialStats ref, test;
+  const RCStorageFormat format   = gpu.storageFormat();
+  const RCStepSchedule  schedule = gpu.stepSchedule();
+  gpu.setStorageFormat(RCStorageFormat::RGBA32F);
+  gpu.setStepSchedule(RCStepSchedule{});
+  const bool measured = radial_stats_of_run(gpu, stats, baseProbeSize, baseIntervalLength, numCascades, resolution, ref);
+  gpu.setStorageFormat(format);
+  gpu.setStepSchedule(schedule);
+  // The test run also leaves the renderer's last result in the requested configuration
+  if (!radial_stats_of_run(gpu, stats, baseProbeSize, baseIntervalLength, numCascades, resolution, test) || !measured) {
+    return false;
+  }
+  out = diffRadialStats(test, ref);
+  return true;
+}
+
+// Full-image error of a configuration against a reference render, reduced on the GPU.
+// The reference is RGBA32F with the reference schedule and 'referenceCascades' cascades
+// (same probe size and interval), so cheaper formats, schedules and fewer cascades can all
+// be judged against one image. Nothing but the five reduced values is read back.
+class ReferenceImageError {
+public:
+  ~ReferenceImageError() { cleanup(); }
+
+  // Renders the reference, then the renderer's current configuration with 'numCascades', and
+  // compares the two. Blocks on the (tiny) readback; the renderer's settings are restored and
+  // its last run is the measured configuration.
+  bool measure(RCGPURenderer& gpu, int baseProbeSize, float baseIntervalLength, int numCascades,
+               int referenceCascades, const glm::ivec2& resolution, ImageErrorMetrics& out) {
+    if (!metrics_.init()) return false;
+    const RCStorageFormat format   = gpu.storageFormat();
+    const RCStepSchedule  schedule = gpu.stepSchedule();
+    gpu.setStorageFormat(RCStorageFormat::RGBA32F);
+    gpu.setStepSchedule(RCStepSchedule{});
+    gpu.run_full_rc(baseProbeSize, baseIntervalLength, referenceCascades, resolution);
+    resources_.ensureTexture2D(reference_, resolution.x, resolution.y, GL_RGBA32F);
+    glCopyImageSubData(gpu.resultTex(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                       reference_, GL_TEXTURE_2D, 0, 0, 0, 0, resolution.x, resolution.y, 1);
+    gpu.setStorageFormat(format);
+    gpu.setStepSchedule(schedule);
+    gpu.run_full_rc(baseProbeSize, baseIntervalLength, numCascades, resolution);
+
+    // Split storage formats keep transmittance out of the result texture; compare radiance only
+    const bool split = rcStorageFormatInfo(gpu.activeStorageFormat()).transmittance != 0;
+    metrics_.dispatch_async(gpu.resultTex(), reference_, resolution.x, resolution.y, split ? 3 : 4);
+    return metrics_.try_read(out, true);
+  }
+
+  void cleanup() {
+    resources_.releaseTexture(reference_);
+    metrics_.cleanup();
+  }
+
+private:
+  AsyncErrorMetrics  metrics_;
+  GpuResourceManager resources_;
+  GLuint reference_ = 0;
+};